@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// microbenchmark 용 작은 runner (외부 benchmark library 없이)
+//
+// kernel 하나를 warmup 한 번 돌린 뒤, repeat 하나가 min_time / repeats 이상 걸리도록
+// iteration 수를 정하고 repeats 번 잰다. iteration 당 시간의 median 을 대표값으로 쓰고
+// (min / max 도 같이), item 당 시간은 median / items.
+// 같은 입력 (고정 seed) 으로 돌리므로 변경 전후 숫자를 바로 비교할 수 있음.
+
+// 결과를 안 쓰는 계산이 최적화로 사라지지 않게
+template <class T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchResult {
+    std::string kernel;
+    std::string config;   // "2d log_poly=14 client=2^12 server=2^16" 같은 parameter 설명
+    size_t items   = 1;   // iteration 하나가 처리하는 원소 / row / ciphertext 수
+    size_t iters   = 0;   // repeat 당 iteration 수
+    size_t repeats = 0;
+    double median_ns = 0;
+    double min_ns    = 0;
+    double max_ns    = 0;
+
+    double ns_per_item() const { return median_ns / static_cast<double>(items); }
+};
+
+class BenchRunner {
+public:
+    BenchRunner(double min_time_ms, size_t repeats, std::string filter)
+        : min_time_ns_(min_time_ms * 1e6), repeats_(repeats == 0 ? 1 : repeats), filter_(std::move(filter)) {}
+
+    bool selected(const std::string& kernel) const {
+        return filter_.empty() || kernel.find(filter_) != std::string::npos;
+    }
+
+    // fn() 한 번 = iteration 하나 (items 개 처리)
+    void run(const std::string& kernel, const std::string& config, size_t items,
+             const std::function<void()>& fn)
+    {
+        if (!selected(kernel)) return;
+        using clock = std::chrono::steady_clock;
+
+        auto t0 = clock::now();
+        fn();   // warmup (cache, allocator)
+        double once_ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+
+        double per_repeat_ns = min_time_ns_ / static_cast<double>(repeats_);
+        size_t iters = static_cast<size_t>(std::ceil(per_repeat_ns / std::max(once_ns, 1.0)));
+        iters = std::max<size_t>(iters, 1);
+
+        std::vector<double> samples;
+        samples.reserve(repeats_);
+        for (size_t rep = 0; rep < repeats_; ++rep) {
+            auto start = clock::now();
+            for (size_t i = 0; i < iters; ++i) fn();
+            double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+            samples.push_back(ns / static_cast<double>(iters));
+        }
+        std::sort(samples.begin(), samples.end());
+
+        BenchResult res;
+        res.kernel    = kernel;
+        res.config    = config;
+        res.items     = items == 0 ? 1 : items;
+        res.iters     = iters;
+        res.repeats   = repeats_;
+        res.median_ns = samples[samples.size() / 2];
+        res.min_ns    = samples.front();
+        res.max_ns    = samples.back();
+        print(res);
+        results_.push_back(std::move(res));
+    }
+
+    const std::vector<BenchResult>& results() const { return results_; }
+
+    void write_csv(const std::string& path) const {
+        std::ofstream ofs(path);
+        if (!ofs) throw std::runtime_error("cannot open " + path);
+        ofs << "kernel,config,items,iters,repeats,median_ns,min_ns,max_ns,ns_per_item\n";
+        for (const auto& r : results_) {
+            ofs << r.kernel << ",\"" << r.config << "\"," << r.items << "," << r.iters << ","
+                << r.repeats << "," << std::fixed << std::setprecision(1) << r.median_ns << ","
+                << r.min_ns << "," << r.max_ns << "," << std::setprecision(3) << r.ns_per_item() << "\n";
+            ofs.unsetf(std::ios::fixed);
+        }
+    }
+
+private:
+    static std::string human(double ns) {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(ns < 10 ? 2 : 1);
+        if (ns >= 1e9)      os << ns / 1e9 << " s";
+        else if (ns >= 1e6) os << ns / 1e6 << " ms";
+        else if (ns >= 1e3) os << ns / 1e3 << " us";
+        else                os << ns << " ns";
+        return os.str();
+    }
+
+    static void print(const BenchResult& r) {
+        double spread = r.median_ns > 0 ? (r.max_ns - r.min_ns) / r.median_ns * 100.0 : 0;
+        std::cout << "  " << std::left << std::setw(26) << r.kernel << std::right
+                  << std::setw(12) << human(r.median_ns) << "/iter"
+                  << std::setw(12) << human(r.ns_per_item()) << "/item"
+                  << "   (x" << r.items << ", " << r.repeats << "x" << r.iters << " iters, spread "
+                  << std::fixed << std::setprecision(1) << spread << "%)\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    double min_time_ns_;
+    size_t repeats_;
+    std::string filter_;
+    std::vector<BenchResult> results_;
+};
@@ -0,0 +1,271 @@
+// cuckoo_calibrate.cpp : permutation cuckoo 의 실패 확률을 재서 client 의 L_k / threshold 파일을 만듦
+#include "hashing/cuckoo.h"
+#include "hashing/p_cuckoo.h"
+#include "pcpsi/psi_params.h"
+#include "util/cli.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// usage: psi_cuckoo_calibrate [--packing=2d|1d] [--segments=1,2,4] [--k=1,2,3]
+//                             [--thresholds=100,1000,3000] [--load-step=0.02] [--trials=200]
+//                             [--tries=1] [--target=0.01] [--threads=N] [--csv=cuckoo.csv]
+//                             [--out=cuckoo_thresholds.txt]
+//
+// 실제 PermCuckooTable::insert 로 bins (= segments * slot_count) 에 load * bins 개의 임의 22-bit
+// 원소를 넣고, relocation 한도 안에 못 넣은 원소가 있으면 그 조합은 실패. hash 는 server 가 보내는
+// 것과 같은 generate_fixed_hash_functions(bins, 20) 이고, client 처럼 get_combinations 순서로
+// 조합을 --tries 개까지 시도해서 모두 실패하면 그 trial 은 실패로 센다.
+//   --tries=1       : 첫 조합 하나 (다음 query 의 rebuild_table, pinned 조합처럼 조합이 정해진 경우)
+//   --tries=16      : setup 의 adaptive 선택 (PsiParams::max_hash_combinations 개까지).
+//                     성공한 trial 의 평균 시도 수가 client 의 cuckoo 시간 (tries 열)
+//
+// (bins, k, threshold) 마다 load 를 step 씩 올리다가 모든 trial 이 실패하면 멈춤.
+//   L_k = 그 load 까지 실패율이 모두 target 이하인 가장 큰 load (여러 bins 중 가장 작은 값)
+// --out 파일에는 가장 큰 threshold 의 L_k 를 씀 (한도는 실패하는 삽입의 비용만 늘림).
+// client 는 --cuckoo-thresholds=파일 로 읽음 (PsiParams::load_cuckoo_thresholds).
+
+namespace {
+
+constexpr unsigned kDomainBits = 22;
+constexpr size_t   kHashCount  = 20;   // server 가 보내는 hash 개수
+
+uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+struct Point {
+    size_t bins;
+    size_t r;
+    size_t threshold;
+    size_t elements;
+    const std::vector<std::vector<size_t>>* combs;   // 시도할 조합 (client 순서)
+    uint64_t seed;
+};
+
+// thread 하나의 trial buffer (seen 은 2^22 bit, 쓴 bit 만 지움)
+struct TrialScratch {
+    std::vector<uint64_t> seen = std::vector<uint64_t>((size_t(1) << kDomainBits) / 64, 0);
+    std::vector<uint32_t> elems;
+};
+
+// 중복 없는 원소 elements 개를 조합마다 넣어 봄. 성공한 조합까지의 시도 수 (모두 실패면 0)
+size_t run_trial(const Point& p, const std::vector<HashParams>& hashes, uint64_t trial, TrialScratch& s) {
+    std::mt19937_64 rng(splitmix64(p.seed ^ trial));
+
+    s.elems.clear();
+    const uint32_t domain_mask = (uint32_t(1) << kDomainBits) - 1;
+    while (s.elems.size() < p.elements) {
+        uint32_t x = static_cast<uint32_t>(rng()) & domain_mask;
+        uint64_t bit = uint64_t(1) << (x & 63);
+        if (s.seen[x >> 6] & bit) continue;
+        s.seen[x >> 6] |= bit;
+        s.elems.push_back(x);
+    }
+
+    for (uint32_t x : s.elems) s.seen[x >> 6] = 0;
+
+    for (size_t i = 0; i < p.combs->size(); ++i) {
+        // build_successful_p_cuckoo_table 과 같지만 첫 실패에서 멈춤 (insert_all 은 끝까지 넣음)
+        PermCuckooTable table(p.bins, p.threshold, p.r, (*p.combs)[i], hashes);
+        bool ok = true;
+        for (uint32_t x : s.elems) {
+            if (!table.insert(x)) {
+                ok = false;
+                break;
+            }
+        }
+        if (ok) return i + 1;
+    }
+    return 0;
+}
+
+struct PointResult {
+    size_t failures = 0;
+    size_t tries    = 0;   // 성공한 trial 의 시도 수 합
+};
+
+// trials 개를 num_threads 개 thread 가 나눠 돌림
+PointResult run_point(const Point& p, const std::vector<HashParams>& hashes, size_t trials, size_t num_threads) {
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> failures{0};
+    std::atomic<size_t> tries{0};
+    auto worker = [&] {
+        TrialScratch scratch;
+        for (size_t t; (t = next.fetch_add(1)) < trials;) {
+            size_t n = run_trial(p, hashes, t, scratch);
+            if (n == 0) failures.fetch_add(1);
+            else        tries.fetch_add(n);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < std::min(num_threads, trials); ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+    return PointResult{failures.load(), tries.load()};
+}
+
+std::string fmt_load(double load) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3) << load;
+    return os.str();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CliArgs args(argc, argv);
+    const std::string packing = args.get("packing", "2d");
+    PsiParams params;
+    if (packing == "2d")      params = PsiParams::packing_2d();
+    else if (packing == "1d") params = PsiParams::packing_1d();
+    else throw std::invalid_argument("unknown --packing: " + packing + " (2d|1d)");
+    const size_t r = kDomainBits - static_cast<size_t>(params.log_poly_mod);
+
+    auto segments   = args.get_size_list("segments");
+    auto ks         = args.get_size_list("k");
+    auto thresholds = args.get_size_list("thresholds");
+    if (segments.empty())   segments   = {1, 2, 4};
+    if (ks.empty())         ks         = {1, 2, 3};
+    if (thresholds.empty()) thresholds = {100, 1000, params.threshold};
+    std::sort(thresholds.begin(), thresholds.end());
+    thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
+    for (size_t k : ks)
+        if (k < 1 || k >= params.load_factor_thr.size())
+            throw std::invalid_argument("--k must be in 1.." + std::to_string(params.load_factor_thr.size() - 1));
+    for (size_t s : segments)
+        if (s == 0) throw std::invalid_argument("--segments must be positive");
+    if (thresholds.front() == 0) throw std::invalid_argument("--thresholds must be positive");
+
+    const double load_step = args.get_double("load-step", 0.02);
+    const size_t trials    = static_cast<size_t>(args.get_int("trials", 200));
+    const double target    = args.get_double("target", 0.01);
+    const size_t max_tries = static_cast<size_t>(args.get_int("tries", 1));
+    if (max_tries == 0) throw std::invalid_argument("--tries must be positive");
+    size_t num_threads     = static_cast<size_t>(args.get_int("threads", 0));
+    if (num_threads == 0) num_threads = std::max<unsigned>(1, std::thread::hardware_concurrency());
+    if (load_step <= 0 || load_step >= 1) throw std::invalid_argument("--load-step must be in (0, 1)");
+    if (trials == 0) throw std::invalid_argument("--trials must be positive");
+    if (target < 0 || target >= 1) throw std::invalid_argument("--target must be in [0, 1)");
+    if (static_cast<double>(trials) * target < 1.0)
+        std::cout << "note: " << trials << " trials cannot resolve a failure rate of " << target
+                  << "; L_k then means no failure was observed\n";
+
+    std::ofstream csv;
+    if (args.has("csv")) {
+        csv.open(args.get("csv", ""));
+        csv << "packing,bins,k,threshold,tries,load,elements,trials,failures,fail_rate,mean_tries,ms\n";
+    }
+
+    std::cout << "Packing " << packing << " (r = " << r << ", slot_count = " << params.slot_count() << "), "
+              << trials << " trials per point on " << num_threads << " thread(s), up to " << max_tries
+              << " hash combination(s) per set, target failure rate " << target << "\n";
+    std::cout << std::left << std::setw(9) << "bins" << std::setw(4) << "k" << std::setw(11) << "threshold"
+              << std::setw(8) << "load" << std::right << std::setw(12) << "failures" << std::setw(8) << "tries"
+              << std::setw(11) << "ms" << "\n";
+
+    // (k, threshold) -> 측정한 bins 중 가장 작은 안전한 load
+    std::map<std::pair<size_t, size_t>, double> safe;
+
+    for (size_t seg : segments) {
+        const size_t bins = seg * params.slot_count();
+        const auto hashes = generate_fixed_hash_functions(bins, kHashCount);
+
+        for (size_t k : ks) {
+            auto combs = get_combinations(kHashCount, k);   // client 가 시도하는 순서
+            if (combs.size() > max_tries) combs.resize(max_tries);
+
+            for (size_t threshold : thresholds) {
+                double safe_load = 0;
+                bool   safe_so_far = true;
+                for (size_t step = 1;; ++step) {
+                    const double load = std::round(step * load_step * 1e6) / 1e6;
+                    if (load > 1.0) break;
+                    const size_t elements = static_cast<size_t>(std::llround(load * bins));
+                    if (elements > (size_t(1) << (kDomainBits - 1))) break;   // 22-bit domain 의 절반까지만
+
+                    Point p{bins, r, threshold, elements, &combs,
+                            splitmix64((uint64_t(bins) << 40) ^ (uint64_t(k) << 32) ^ (uint64_t(threshold) << 8) ^ step)};
+                    auto start = std::chrono::steady_clock::now();
+                    const PointResult res = run_point(p, hashes, trials, num_threads);
+                    const double ms = std::chrono::duration<double, std::milli>(
+                                          std::chrono::steady_clock::now() - start).count();
+                    const size_t failures = res.failures;
+                    const double rate = static_cast<double>(failures) / static_cast<double>(trials);
+                    const double mean_tries = failures == trials
+                        ? 0.0 : static_cast<double>(res.tries) / static_cast<double>(trials - failures);
+
+                    if (safe_so_far && rate <= target) safe_load = load;
+                    else                               safe_so_far = false;
+
+                    std::cout << std::left << std::setw(9) << bins << std::setw(4) << k << std::setw(11) << threshold
+                              << std::setw(8) << fmt_load(load) << std::right
+                              << std::setw(12) << (std::to_string(failures) + "/" + std::to_string(trials))
+                              << std::fixed << std::setprecision(1) << std::setw(8) << mean_tries
+                              << std::setw(11) << ms << "\n";
+                    std::cout.unsetf(std::ios::fixed);
+                    if (csv.is_open())
+                        csv << packing << "," << bins << "," << k << "," << threshold << "," << combs.size() << ","
+                            << load << "," << elements << "," << trials << "," << failures << "," << rate << ","
+                            << mean_tries << "," << ms << "\n";
+
+                    if (failures == trials) break;   // 실패율은 load 에 대해 단조
+                }
+                auto key = std::make_pair(k, threshold);
+                auto it  = safe.find(key);
+                if (it == safe.end()) safe.emplace(key, safe_load);
+                else                  it->second = std::min(it->second, safe_load);
+            }
+        }
+    }
+
+    // ---- 요약: k 별 L_k (threshold 마다) ----
+    std::cout << "\nCalibrated L_k (largest load with failure rate <= " << target << ", min over bins)\n";
+    std::cout << std::left << std::setw(4) << "k" << std::setw(10) << "current";
+    for (size_t threshold : thresholds) std::cout << std::setw(12) << ("thr " + std::to_string(threshold));
+    std::cout << "\n";
+    for (size_t k : ks) {
+        std::cout << std::left << std::setw(4) << k << std::setw(10) << fmt_load(params.load_factor_thr[k]);
+        for (size_t threshold : thresholds) std::cout << std::setw(12) << fmt_load(safe[{k, threshold}]);
+        std::cout << "\n";
+    }
+
+    if (args.has("out")) {
+        const std::string out_path = args.get("out", "");
+        const size_t threshold = thresholds.back();
+        std::ofstream out(out_path);
+        if (!out) throw std::runtime_error("cannot open " + out_path);
+        out << "# psi_cuckoo_calibrate: packing " << packing << ", bins";
+        for (size_t i = 0; i < segments.size(); ++i) out << (i ? "," : " ") << segments[i] * params.slot_count();
+        out << ", " << trials << " trials, up to " << max_tries << " combination(s), target failure rate "
+            << target << "\n";
+        out << "threshold " << threshold << "\n";
+        for (size_t k : ks) out << "k " << k << " " << safe[{k, threshold}] << "\n";
+        std::cout << "Thresholds (relocation limit " << threshold << ") written to " << out_path << "\n";
+
+        // client 가 그대로 쓸 수 있는지 (segment 개수는 L_{hash_count} 로 정함)
+        PsiParams check = params;
+        check.load_cuckoo_thresholds(out_path);
+        try {
+            check.validate();
+        } catch (const std::exception& e) {
+            std::cout << "warning: " << e.what() << " (the client will reject this file)\n";
+        }
+    }
+    return 0;
+}
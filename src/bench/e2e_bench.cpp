@@ -0,0 +1,292 @@
+// e2e_bench.cpp : client + server 를 한 process 에서 loopback (또는 emulated network) 으로 돌리는 sweep
+#include "network/transport.h"
+#include "pcpsi/psi_client.h"
+#include "pcpsi/psi_server.h"
+#include "util/cli.h"
+#include "util/json.h"
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// usage: psi_e2e_bench [--client-exps=8,10,12] [--server-exps=16,20] [--packing=2d,1d]
+//                      [--threads=1,4] [--queries=3] [--stripes=1] [--pipeline-depth=8]
+//                      [--transport=tcp|unix|shm] [--port=9300] [--socket-path=...] [--net=wan]
+//                      [--csv=e2e.csv] [--json=e2e.json] [--log=e2e_bench.log] [--phase-log=phases.jsonl]
+//                      [--stream-window=N] [--mask-pool=32] [--cuckoo-thresholds=path]
+//
+// grid 의 조합마다 PsiServer / PsiClient 를 새로 만들어 (cold) session 하나에 query 를
+// --queries 번 보낸다. query 마다 record 하나 (phase 시간, byte 수, 교집합 검증).
+// 원소는 22 bit 이므로 client + server set 이 2^21 을 넘는 조합은 건너뜀.
+// protocol 로그 (서버/클라이언트 cout) 는 --log 파일로 보내고 화면에는 요약만.
+// --phase-log 를 주면 run 마다 server / client 의 phase record 가 한 줄씩 추가됨.
+
+namespace {
+
+constexpr uint32_t kDomainMask = (uint32_t(1) << 22) - 1;
+constexpr size_t   kMaxElements = size_t(1) << 21;
+
+struct Dataset {
+    std::vector<uint32_t> client;
+    std::vector<uint32_t> server;
+    size_t expected = 0;   // 교집합 크기
+};
+
+// server set 은 client set 의 앞쪽 1/4 을 포함 (고정 seed)
+Dataset make_dataset(size_t client_exp, size_t server_exp) {
+    size_t client_size = size_t(1) << client_exp;
+    size_t server_size = size_t(1) << server_exp;
+    std::mt19937_64 rng(0x453245ULL * (client_exp + 1) + server_exp);
+    std::unordered_set<uint32_t> seen;
+    seen.reserve(2 * (client_size + server_size));
+    std::vector<uint32_t> all;
+    all.reserve(client_size + server_size);
+    while (all.size() < client_size + server_size) {
+        uint32_t x = static_cast<uint32_t>(rng()) & kDomainMask;
+        if (seen.insert(x).second) all.push_back(x);
+    }
+
+    Dataset d;
+    d.client.assign(all.begin(), all.begin() + client_size);
+    d.server.assign(all.begin() + client_size, all.end());
+    d.expected = std::min(client_size / 4, server_size);
+    for (size_t i = 0; i < d.expected; ++i) d.server[i] = d.client[i];
+    return d;
+}
+
+// 같은 process 안이라도 각자 uplink 를 가져야 양방향이 bandwidth 를 나눠 쓰지 않음
+TransportConfig with_own_link(TransportConfig t) {
+    if (t.net.enabled()) t.link = std::make_shared<NetLink>(t.net.bandwidth_bps);
+    return t;
+}
+
+double ms(long long us) { return static_cast<double>(us) / 1000.0; }
+
+template <class Clock>
+double ms_since(typename Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// CSV column 과 JSON key 가 같은 record
+class Record {
+public:
+    template <class T>
+    Record& set(const std::string& key, T v) {
+        std::ostringstream os;
+        os << v;
+        cols_.emplace_back(key, os.str());
+        json_.add(key, v);
+        return *this;
+    }
+
+    std::string header() const {
+        std::string h;
+        for (const auto& [k, v] : cols_) h += (h.empty() ? "" : ",") + k;
+        return h;
+    }
+    std::string csv() const {
+        std::string line;
+        for (const auto& [k, v] : cols_) line += (line.empty() ? "" : ",") + v;
+        return line;
+    }
+    std::string json() const { return json_.str(); }
+
+private:
+    std::vector<std::pair<std::string, std::string>> cols_;
+    JsonObject json_;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CliArgs args(argc, argv);
+    auto packings    = args.get_list("packing");
+    auto client_exps = args.get_size_list("client-exps");
+    auto server_exps = args.get_size_list("server-exps");
+    auto threads     = args.get_size_list("threads");
+    if (packings.empty())    packings    = {"2d", "1d"};
+    if (client_exps.empty()) client_exps = {8, 10, 12};
+    if (server_exps.empty()) server_exps = {16};
+    if (threads.empty())     threads     = {0};
+    size_t num_queries = static_cast<size_t>(args.get_int("queries", 3));
+    if (num_queries == 0) throw std::invalid_argument("--queries must be positive");
+
+    int port = static_cast<int>(args.get_int("port", 9300));
+    TransportConfig client_transport = TransportConfig::from_args(args, "127.0.0.1", port);
+    TransportConfig server_transport = with_own_link(client_transport);
+    server_transport.host = "0.0.0.0";
+
+    PsiServerOptions server_opts;
+    server_opts.pipeline_depth = static_cast<size_t>(args.get_int("pipeline-depth", 8));
+    server_opts.phase_log      = args.get("phase-log", "");
+    server_opts.stream_window  = static_cast<size_t>(args.get_int("stream-window", 0));
+    server_opts.mask_pool      = static_cast<size_t>(args.get_int("mask-pool", 32));
+
+    std::ofstream log(args.get("log", "e2e_bench.log"));
+    std::ofstream csv, json;
+    if (args.has("csv"))  csv.open(args.get("csv", ""));
+    if (args.has("json")) json.open(args.get("json", ""));
+    bool csv_header = false;
+    bool json_first = true;
+    if (json.is_open()) json << "[\n";
+
+    std::cout << "Transport: " << client_transport.describe() << "\n";
+    std::cout << std::left << std::setw(6) << "pack" << std::setw(8) << "client" << std::setw(8) << "server"
+              << std::setw(8) << "threads" << std::setw(6) << "segs" << std::setw(4) << "k"
+              << std::right << std::setw(11) << "setup ms" << std::setw(11) << "online ms"
+              << std::setw(12) << "s->c MB" << std::setw(10) << "result" << "\n";
+
+    // 한 번만 listen 하고 run 마다 session 하나씩 받음
+    auto listener = make_listener(server_transport, 16);
+    size_t run_id = 0;
+    size_t failures = 0;
+
+    for (const auto& packing : packings) {
+        PsiParams params;
+        if (packing == "2d")      params = PsiParams::packing_2d();
+        else if (packing == "1d") params = PsiParams::packing_1d();
+        else throw std::invalid_argument("unknown --packing: " + packing + " (2d|1d)");
+        // psi_cuckoo_calibrate 의 L_k / threshold (packing 마다 따로 calibrate 했으면 run 을 나눠서)
+        if (args.has("cuckoo-thresholds")) params.load_cuckoo_thresholds(args.get("cuckoo-thresholds", ""));
+
+        for (size_t server_exp : server_exps) {
+            for (size_t client_exp : client_exps) {
+                if ((size_t(1) << client_exp) + (size_t(1) << server_exp) > kMaxElements) {
+                    std::cout << packing << " client=2^" << client_exp << " server=2^" << server_exp
+                              << ": skipped (more than 2^21 elements in the 22-bit domain)\n";
+                    continue;
+                }
+                Dataset data = make_dataset(client_exp, server_exp);
+
+                for (size_t num_threads : threads) {
+                    ++run_id;
+                    std::vector<Record> records;
+                    size_t segments = 0, hash_count = 0;
+                    double setup_ms = 0, last_online_ms = 0, last_s2c_mb = 0;
+                    bool all_ok = true;
+                    std::string error;
+
+                    // protocol 로그는 파일로
+                    auto* saved = std::cout.rdbuf(log.rdbuf());
+                    std::cout << "\n######## run " << run_id << ": " << packing << " client=2^" << client_exp
+                              << " server=2^" << server_exp << " threads=" << num_threads << " ########\n";
+                    try {
+                        using clock = std::chrono::steady_clock;
+                        auto start_server = clock::now();
+                        PsiServer server(params, data.server, server_opts);
+                        double server_init_ms = ms_since<clock>(start_server);
+
+                        std::exception_ptr server_error;
+                        std::thread server_thread([&] {
+                            try {
+                                server.serve_one(*listener, server_transport);
+                            } catch (...) {
+                                server_error = std::current_exception();
+                            }
+                        });
+
+                        PsiClientOptions client_opts;
+                        client_opts.num_threads = num_threads;
+                        client_opts.num_stripes = static_cast<size_t>(args.get_int("stripes", 1));
+                        client_opts.phase_log   = server_opts.phase_log;
+                        auto start_client = clock::now();
+                        PsiClient client(params, client_opts);
+                        double client_init_ms = ms_since<clock>(start_client);
+
+                        try {
+                            client.connect(client_transport);
+                            for (size_t q = 0; q < num_queries; ++q) {
+                                auto start_query = clock::now();
+                                PsiQueryResult res = client.query(data.client);
+                                double query_ms = ms_since<clock>(start_query);
+                                const PsiSetupInfo& setup = client.setup_info();
+
+                                Record rec;
+                                rec.set("run", run_id).set("query", q + 1)
+                                   .set("packing", packing).set("log_poly_mod", params.log_poly_mod)
+                                   .set("client_exp", client_exp).set("server_exp", server_exp)
+                                   .set("threads", num_threads).set("stripes", setup.num_stripes)
+                                   .set("transport", client_transport.describe())
+                                   .set("segments", setup.num_segments).set("hash_count", setup.hash_indices.size())
+                                   .set("server_init_ms", server_init_ms).set("client_init_ms", client_init_ms)
+                                   .set("setup_ms", q == 0 ? ms(setup.us_setup) : 0.0)
+                                   .set("setup_bytes_c2s", q == 0 ? setup.bytes_sent : 0)
+                                   .set("setup_bytes_s2c", q == 0 ? setup.bytes_recv : 0)
+                                   .set("query_ms", query_ms)
+                                   .set("hash_ms", ms(res.us_hash)).set("enc_ms", ms(res.us_enc))
+                                   .set("online_ms", ms(res.us_online)).set("dec_ms", ms(res.us_dec))
+                                   .set("check_ms", ms(res.us_check))
+                                   .set("send_ms", ms(static_cast<long long>(res.us_send)))
+                                   .set("recv_ms", ms(static_cast<long long>(res.us_recv)))
+                                   .set("bytes_c2s", res.bytes_sent).set("bytes_s2c", res.bytes_recv)
+                                   .set("intersection", res.intersection.size()).set("expected", data.expected)
+                                   .set("ok", res.intersection.size() == data.expected);
+                                records.push_back(std::move(rec));
+
+                                segments       = setup.num_segments;
+                                hash_count     = setup.hash_indices.size();
+                                setup_ms       = ms(setup.us_setup);
+                                last_online_ms = ms(res.us_online);
+                                last_s2c_mb    = res.bytes_recv / (1024.0 * 1024.0);
+                                all_ok &= res.intersection.size() == data.expected;
+                            }
+                            client.close();
+                        } catch (...) {
+                            client.close();
+                            server_thread.join();
+                            throw;
+                        }
+                        server_thread.join();
+                        if (server_error) std::rethrow_exception(server_error);
+                    } catch (const std::exception& e) {
+                        error = e.what();
+                    }
+                    std::cout.flush();
+                    std::cout.rdbuf(saved);
+
+                    // ---- 요약 + 기록 ----
+                    std::cout << std::left << std::setw(6) << packing
+                              << std::setw(8) << ("2^" + std::to_string(client_exp))
+                              << std::setw(8) << ("2^" + std::to_string(server_exp))
+                              << std::setw(8) << num_threads;
+                    if (!error.empty() || records.empty()) {
+                        ++failures;
+                        std::cout << "FAILED: " << (error.empty() ? "no queries" : error) << "\n";
+                        continue;
+                    }
+                    for (const auto& rec : records) {
+                        if (csv.is_open()) {
+                            if (!csv_header) { csv << rec.header() << "\n"; csv_header = true; }
+                            csv << rec.csv() << "\n";
+                        }
+                        if (json.is_open()) {
+                            json << (json_first ? "  " : ",\n  ") << rec.json();
+                            json_first = false;
+                        }
+                    }
+                    if (!all_ok) ++failures;
+
+                    // 화면에는 첫 query 의 setup 과 마지막 query (warm) 의 online
+                    std::cout << std::setw(6) << segments << std::setw(4) << hash_count << std::right
+                              << std::fixed << std::setprecision(2)
+                              << std::setw(11) << setup_ms << std::setw(11) << last_online_ms
+                              << std::setw(12) << last_s2c_mb
+                              << std::setw(10) << (all_ok ? "ok" : "WRONG") << "\n";
+                    std::cout.unsetf(std::ios::fixed);
+                }
+            }
+        }
+    }
+
+    if (json.is_open()) json << "\n]\n";
+    std::cout << "\n" << run_id << " runs, " << failures << " failed\n";
+    return failures == 0 ? 0 : 1;
+}
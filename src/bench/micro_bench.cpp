@@ -0,0 +1,371 @@
+// micro_bench.cpp : hot kernel 별 microbenchmark
+#include "bench/bench_runner.h"
+#include "hashing/cuckoo.h"
+#include "hashing/p_cuckoo.h"
+#include "hashing/simple.h"
+#include "network/psi_wire.h"
+#include "network/wire.h"
+#include "pcpsi/psi_params.h"
+#include "protocol/intersection.h"
+#include "protocol/labels.h"
+#include "protocol/mask_pool.h"
+#include "protocol/server_eval.h"
+#include "seal_util/batching.h"
+#include "seal_util/parallel_decrypt.h"
+#include "seal_util/psi_parms.h"
+#include "seal_util/slot_packing.h"
+#include "util/cli.h"
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <sys/socket.h>
+#include "seal/seal.h"
+
+// usage: psi_microbench [--packing=2d,1d] [--client-exps=10,12] [--server-exps=16]
+//                       [--filter=cuckoo] [--min-time-ms=300] [--repeats=5] [--csv=out.csv]
+//
+// 입력은 고정 seed 로 만들고, kernel 은 protocol 과 같은 함수를 그대로 부른다.
+//   hash.universal          : PermCuckooTable::universal_hash (원소 하나)
+//   cuckoo.insert_all       : client set 전체 (PermCuckooTable 생성 포함)
+//   simple.insert_all       : server set 전체, hash 하나 (PermSimpleHashTable 생성 포함)
+//   simple.pack             : 2^r - x_R + d-way packing (Packing::pack_table)
+//   simple.pad              : segment 하나 pad_simple_table_vec
+//   simple.encode           : segment 하나 encode_simple_table (row 단위)
+//   simple.encode_fused     : segment 하나 RowEncoder::encode_segment (pack + pad + encode 한 번에)
+//   query.encrypt_range     : batch_encrypt_cuckoo_bins_range (segment 하나)
+//   mask.generate           : CSPRNG + encode + NTT (MaskGenerator, mask 하나)
+//   eval.row                : add_plain + multiply_plain (row 하나, NTT form mask)
+//   eval.row_coeff_mask     : 위와 같지만 mask 를 NTT 로 바꾸지 않은 경우
+//   seal.serialize          : 결과 ciphertext save
+//   seal.deserialize        : 결과 ciphertext load
+//   wire.send_recv          : socketpair 위 send_seal_obj / recv_seal_obj
+//   client.decrypt_decode   : ParallelDecryptor (ciphertext 하나)
+//   client.check            : IntersectionChecker::check (결과 ciphertext 하나)
+//
+// label.binding 은 시간 대신 labeled mode 를 검사한다 (--filter 로 끌 수 있음, 어긋나면 runtime_error).
+// chosen hash 마다 server table 과 label row 를 만들어 client key 로 평가하고 전부 복호해서,
+// label 이 풀린 slot 이 교집합 원소 (같은 hash, 같은 x_R) 뿐인지 본다. 같은 bin 에 다른 hash 로
+// 들어간 같은 x_R 의 server 원소와 빈 client bin 의 y_R == 0 원소가 따로 세어진다.
+
+namespace {
+
+constexpr uint32_t kDomainMask = (uint32_t(1) << 22) - 1;   // x 는 22 bit
+
+// [0, 2^22) 에서 중복 없는 n 개
+std::vector<uint32_t> random_set(size_t n, std::mt19937_64& rng) {
+    std::unordered_set<uint32_t> seen;
+    seen.reserve(n * 2);
+    while (seen.size() < n) seen.insert(static_cast<uint32_t>(rng()) & kDomainMask);
+    return std::vector<uint32_t>(seen.begin(), seen.end());
+}
+
+template <class Packing>
+void check_label_binding(const seal::SEALContext& context, seal::Encryptor& encryptor, const seal::Evaluator& evaluator,
+                         seal::BatchEncoder& batch_encoder, ParallelDecryptor& decryptor,
+                         const PermCuckooTable& cuckoo, const std::vector<size_t>& comb,
+                         const std::vector<HashParams>& all_hashes, const std::vector<uint32_t>& server_elems)
+{
+    const size_t slot_count = batch_encoder.slot_count();
+    const size_t bins       = cuckoo.get_table().size();
+
+    ServerLabels labels;
+    labels.label_bits = 48;   // chunk 여러 개 (우연히 label 과 같은 난수가 나올 확률 ~ 2^-48)
+    for (uint32_t y : server_elems)
+        labels.labels[y] = ((uint64_t(y) * 0x9e3779b97f4a7c15ULL) >> 16) | 1;   // 0 이 아닌 48 bit
+    const LabelLayout<Packing> layout(labels.label_bits);
+
+    std::vector<std::shared_ptr<const PermSimpleHashTable>> tables;
+    for (size_t idx : comb) {
+        auto table = std::make_shared<PermSimpleHashTable>(bins, Packing::r, std::vector<HashParams>{all_hashes[idx]});
+        table->insert_all(server_elems);
+        tables.push_back(std::move(table));
+    }
+    const ServerLabelRows label_rows = encode_label_tables<Packing>(tables, labels, layout, slot_count, batch_encoder);
+    const std::vector<seal::Ciphertext> key_cts =
+        batch_encrypt_cuckoo_bins_segments(label_keys<Packing>(cuckoo), encryptor, batch_encoder);
+    MaskPool<Packing> masks(context, batch_encoder, evaluator, 0, nullptr, MaskKind::uniform);
+
+    const auto& entries = cuckoo.get_table();
+    size_t members = 0, same_x_r = 0, empty_zero = 0;
+    std::vector<seal::Ciphertext> cts;
+    std::vector<std::vector<uint64_t>> slots;
+    for (size_t h = 0; h < tables.size(); ++h) {
+        const auto& server_bins = tables[h]->get_table();
+        for (size_t seg = 0; seg < label_rows[h].size(); ++seg) {
+            for (size_t row = 0; row < label_rows[h][seg].size(); ++row) {
+                cts.clear();
+                evaluate_label_row(evaluator, key_cts[seg], label_rows[h][seg][row], layout, masks,
+                                   [&](const seal::Ciphertext& ct) { cts.push_back(ct); });
+                decryptor.decrypt_decode(cts, slots);
+                for (size_t lane = 0; lane < Packing::d; ++lane) {
+                    const size_t j = row * Packing::d + lane;
+                    for (size_t i = 0; i < slot_count; ++i) {
+                        const size_t bin = seg * slot_count + i;
+                        if (j >= server_bins[bin].size()) continue;
+                        const uint32_t y_r = server_bins[bin][j];
+                        uint64_t label = 0;
+                        for (size_t c = 0; c < layout.chunks(); ++c)
+                            layout.add_chunk(label, c, slots[lane * layout.chunks() + c][i]);
+                        const bool opened = label == labels.labels.at(tables[h]->recover_element(bin, y_r));
+                        const auto& e     = entries[bin];
+                        const bool member = e && e->hash_idx == h && e->x_r == y_r;
+                        if (opened != member)
+                            throw std::runtime_error("label self-check: bin " + std::to_string(bin) + ", hash " +
+                                                     std::to_string(h) + (member ? " lost the label of a member"
+                                                                                 : " opened the label of a non-member"));
+                        members    += member;
+                        same_x_r   += e && e->hash_idx != h && e->x_r == y_r;
+                        empty_zero += !e && y_r == 0;
+                    }
+                }
+            }
+        }
+    }
+    std::cout << "  label.binding: " << members << " member labels opened; " << same_x_r
+              << " same-x_R lanes of other hashes and " << empty_zero
+              << " y_R == 0 lanes in empty bins stayed masked\n";
+}
+
+template <class Packing>
+void bench_params(BenchRunner& bench, const PsiParams& params, size_t client_exp, size_t server_exp) {
+    const size_t client_size = size_t(1) << client_exp;
+    const size_t server_size = size_t(1) << server_exp;
+    if (client_size + server_size > (size_t(1) << 21))
+        throw std::invalid_argument("client + server set too large for the 22-bit domain");
+
+    std::string config = std::string(params.packing == PsiPacking::packing_2d ? "2d" : "1d") +
+                         " log_poly=" + std::to_string(params.log_poly_mod) +
+                         " client=2^" + std::to_string(client_exp) +
+                         " server=2^" + std::to_string(server_exp);
+    std::cout << "\n==== " << config << " ====\n";
+
+    // ---- 입력 (고정 seed): server set 은 client set 의 1/4 을 포함 ----
+    std::mt19937_64 rng(0x4d4943524fULL + client_exp * 131 + server_exp);
+    auto all = random_set(client_size + server_size, rng);
+    std::vector<uint32_t> client_elems(all.begin(), all.begin() + client_size);
+    std::vector<uint32_t> server_elems(all.begin() + client_size, all.end());
+    for (size_t i = 0; i < client_size / 4 && i < server_elems.size(); ++i) server_elems[i] = client_elems[i];
+
+    // ---- SEAL ----
+    seal::EncryptionParameters parms = make_psi_parms<Packing>(params.log_poly_mod);
+    seal::SEALContext context(parms);
+    seal::KeyGenerator keygen(context);
+    seal::PublicKey public_key;
+    keygen.create_public_key(public_key);
+    seal::Encryptor encryptor(context, public_key);
+    seal::Evaluator evaluator(context);
+    seal::BatchEncoder batch_encoder(context);
+    ParallelDecryptor decryptor(context, keygen.secret_key(), 1);   // kernel 자체 비용 (thread 1개)
+    const size_t slot_count = batch_encoder.slot_count();
+    const size_t r          = Packing::r;
+
+    // ---- client 쪽 hash 선택 (protocol 과 같은 방식) ----
+    size_t num_segments = num_query_segments(client_size, slot_count, params.load_factor_thr[params.hash_count]);
+    std::optional<PermCuckooBuildResult> built;
+    std::vector<HashParams> all_hashes;
+    for (; num_segments <= 256 && !built; num_segments <<= 1) {
+        size_t bins = num_segments * slot_count;
+        all_hashes = generate_fixed_hash_functions(bins, 20);
+        double load = static_cast<double>(client_size) / static_cast<double>(bins);
+        for (size_t k = 1; k <= params.hash_count && !built; ++k) {
+            if (load > params.load_factor_thr[k]) continue;
+            built = build_successful_p_cuckoo_table(
+                bins, params.threshold, r, params.hash_combinations(all_hashes.size(), k), all_hashes, client_elems);
+        }
+        if (built) break;
+    }
+    if (!built) throw std::runtime_error("no cuckoo table for " + config);
+    const size_t bins = num_segments * slot_count;
+    const std::vector<size_t> comb = built->chosen_indices;
+    const PermCuckooTable& cuckoo = built->table;
+    std::cout << "  segments " << num_segments << ", k* = " << comb.size() << "\n";
+
+    if (bench.selected("label.binding"))
+        check_label_binding<Packing>(context, encryptor, evaluator, batch_encoder, decryptor,
+                                     cuckoo, comb, all_hashes, server_elems);
+
+    // hash.universal
+    {
+        const HashParams& h = all_hashes[comb[0]];
+        bench.run("hash.universal", config, client_size, [&] {
+            uint64_t acc = 0;
+            for (auto x : client_elems) acc += cuckoo.universal_hash(h, x & ((1u << r) - 1));
+            do_not_optimize(acc);
+        });
+    }
+
+    // cuckoo.insert_all
+    bench.run("cuckoo.insert_all", config, client_size, [&] {
+        PermCuckooTable table(bins, params.threshold, r, comb, all_hashes);
+        size_t failed = table.insert_all(client_elems);
+        do_not_optimize(failed);
+    });
+
+    // simple.insert_all (hash 하나)
+    std::vector<HashParams> one_hash = {all_hashes[comb[0]]};
+    bench.run("simple.insert_all", config, server_size, [&] {
+        PermSimpleHashTable table(bins, r, one_hash);
+        table.insert_all(server_elems);
+        do_not_optimize(table.get_table().data());
+    });
+
+    // ---- server table -> packed -> segment 0 ----
+    PermSimpleHashTable simple(bins, r, one_hash);
+    simple.insert_all(server_elems);
+
+    bench.run("simple.pack", config, bins, [&] {
+        auto packed = Packing::pack_table(simple.get_table());
+        do_not_optimize(packed.data());
+    });
+
+    auto segments = split_simple_table_segments(Packing::pack_table(simple.get_table()), slot_count);
+    const auto& seg0 = segments[0];
+    bench.run("simple.pad", config, seg0.size(), [&] {
+        auto padded = pad_simple_table_vec(seg0, uint64_t(0));
+        do_not_optimize(padded.data());
+    });
+
+    auto padded = pad_simple_table_vec(seg0, uint64_t(0));
+    auto rows   = encode_simple_table(padded, batch_encoder, uint64_t(0));
+    std::cout << "  segment 0: " << rows.size() << " rows\n";
+    bench.run("simple.encode", config, rows.size(), [&] {
+        auto pts = encode_simple_table(padded, batch_encoder, uint64_t(0));
+        do_not_optimize(pts.data());
+    });
+
+    // 위 세 단계 (pack, pad, encode) 를 한 번에, buffer 는 반복 사이에 재사용
+    RowEncoder<Packing> row_encoder(simple, slot_count);
+    SlotRows slot_rows;
+    std::vector<seal::Plaintext> fused_rows;
+    bench.run("simple.encode_fused", config, row_encoder.rows(0), [&] {
+        row_encoder.encode_segment(0, batch_encoder, slot_rows, fused_rows);
+        do_not_optimize(fused_rows.data());
+    });
+
+    // ---- client query ----
+    std::vector<uint64_t> cuckoo_bins(bins, 0);
+    const auto& entries = cuckoo.get_table();
+    for (size_t i = 0; i < bins; ++i)
+        if (entries[i].has_value()) cuckoo_bins[i] = Packing::replicate(entries[i]->x_r);
+
+    bench.run("query.encrypt_range", config, 1, [&] {
+        auto ct = batch_encrypt_cuckoo_bins_range(cuckoo_bins, 0, slot_count - 1, encryptor, batch_encoder);
+        do_not_optimize(&ct);
+    });
+    seal::Ciphertext query_ct =
+        batch_encrypt_cuckoo_bins_range(cuckoo_bins, 0, slot_count - 1, encryptor, batch_encoder);
+
+    // ---- 평가 (row 하나) ----
+    MaskGenerator<Packing> mask_gen(context, batch_encoder, evaluator);
+    seal::Plaintext mask;
+    bench.run("mask.generate", config, 1, [&] {
+        mask_gen.generate(mask);
+        do_not_optimize(&mask);
+    });
+    mask_gen.generate(mask);
+
+    seal::Ciphertext result_ct;
+    bench.run("eval.row", config, 1, [&] {
+        evaluate_row(evaluator, query_ct, rows[0], mask, result_ct);
+        do_not_optimize(&result_ct);
+    });
+
+    std::vector<uint64_t> coeff_slots(slot_count);
+    for (size_t i = 0; i < slot_count; ++i) coeff_slots[i] = Packing::odd_mask(rng());
+    seal::Plaintext coeff_mask;
+    batch_encoder.encode(coeff_slots, coeff_mask);
+    bench.run("eval.row_coeff_mask", config, 1, [&] {
+        evaluate_row(evaluator, query_ct, rows[0], coeff_mask, result_ct);
+        do_not_optimize(&result_ct);
+    });
+    evaluate_row(evaluator, query_ct, rows[0], mask, result_ct);   // 아래 kernel 은 NTT mask 결과로
+
+    // ---- 직렬화 / 전송 ----
+    bench.run("seal.serialize", config, 1, [&] {
+        auto buf = serialize_seal_obj(result_ct);
+        do_not_optimize(buf.data());
+    });
+    auto result_buf = serialize_seal_obj(result_ct);
+    seal::Ciphertext loaded;
+    bench.run("seal.deserialize", config, 1, [&] {
+        load_seal_obj(result_buf, loaded, context);
+        do_not_optimize(&loaded);
+    });
+
+    {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) throw std::runtime_error("socketpair");
+        Wire tx(fds[0], Wire::adopt_fd_t{});
+        Wire rx(fds[1], Wire::adopt_fd_t{});
+        const size_t batch = 16;   // thread 생성 비용을 나눠 가지도록 iteration 당 16개
+        bench.run("wire.send_recv", config, batch, [&] {
+            std::thread sender([&] {
+                for (size_t i = 0; i < batch; ++i) send_seal_obj(tx, result_ct);
+                tx.flush();
+            });
+            seal::Ciphertext ct;
+            for (size_t i = 0; i < batch; ++i) recv_seal_obj(rx, ct, context);
+            sender.join();
+            do_not_optimize(&ct);
+        });
+    }
+
+    // ---- client 복호 / 검사 (segment 0, hash 0 의 결과 하나) ----
+    std::vector<seal::Ciphertext> one_ct = {result_ct};
+    std::vector<std::vector<uint64_t>> slots;
+    bench.run("client.decrypt_decode", config, 1, [&] {
+        decryptor.decrypt_decode(one_ct, slots);
+        do_not_optimize(slots.data());
+    });
+
+    decryptor.decrypt_decode(one_ct, slots);
+    IntersectionChecker<Packing> checker(cuckoo, comb.size(), slot_count);
+    bench.run("client.check", config, 1, [&] {
+        checker.reset();   // 결과가 iteration 마다 쌓이지 않게
+        checker.check(0, 0, slots[0]);
+        do_not_optimize(checker.count(0));
+    });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CliArgs args(argc, argv);
+    auto packings    = args.get_list("packing");
+    auto client_exps = args.get_size_list("client-exps");
+    auto server_exps = args.get_size_list("server-exps");
+    if (packings.empty())    packings    = {"2d", "1d"};
+    if (client_exps.empty()) client_exps = {10, 12};
+    if (server_exps.empty()) server_exps = {16};
+
+    BenchRunner bench(args.get_double("min-time-ms", 300),
+                      static_cast<size_t>(args.get_int("repeats", 5)),
+                      args.get("filter", ""));
+
+    for (const auto& packing : packings) {
+        PsiParams params;
+        if (packing == "2d")      params = PsiParams::packing_2d();
+        else if (packing == "1d") params = PsiParams::packing_1d();
+        else throw std::invalid_argument("unknown --packing: " + packing + " (2d|1d)");
+
+        for (size_t client_exp : client_exps) {
+            for (size_t server_exp : server_exps) {
+                if (params.packing == PsiPacking::packing_2d)
+                    bench_params<Packing2D>(bench, params, client_exp, server_exp);
+                else
+                    bench_params<Packing1D>(bench, params, client_exp, server_exp);
+            }
+        }
+    }
+
+    if (args.has("csv")) {
+        bench.write_csv(args.get("csv", ""));
+        std::cout << "\nResults written to " << args.get("csv", "") << "\n";
+    }
+    return 0;
+}
@@ -16,3 +16,18 @@ std::vector<uint32_t> read_uint32_file(const std::string& path) {
     return result;
 }
 
+std::unordered_map<uint32_t, uint64_t> read_label_file(const std::string& path) {
+    std::unordered_map<uint32_t, uint64_t> result;
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        std::cerr << "Failed to open file: " << path << std::endl;
+        return result;
+    }
+    uint32_t element;
+    uint64_t label;
+    while (ifs >> element >> label) {
+        result[element] = label;
+    }
+    return result;
+}
+
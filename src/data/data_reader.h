@@ -2,6 +2,10 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <unordered_map>
 
 // Reads a text file where each line is a uint32_t and returns as a vector
 std::vector<uint32_t> read_uint32_file(const std::string& path);
+
+// Reads "element label" pairs (one per line) for the labeled server
+std::unordered_map<uint32_t, uint64_t> read_label_file(const std::string& path);
@@ -1,5 +1,7 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
+#include <stdexcept>
 #include <string>
 
 // Common hash function parameter struct
@@ -10,3 +12,51 @@ struct HashParams {
     uint64_t mod;
     std::string name;
 };
+
+// 원소 x 는 22 bit (x = x_L << r | x_R)
+constexpr unsigned kElementBits = 22;
+
+// permutation hashing 의 bin 배치 (PermCuckooTable / PermSimpleHashTable 공통)
+//
+// bins 를 2^(22 - r) 개씩 segment 로 나눈다 (client query ciphertext 하나 = segment 하나).
+//   segment 안의 위치 = x_L ^ H(x_R)   (segment 크기로 자름, 위치와 x_R 로 x_L 이 복원됨)
+//   segment          = x 전체와 hash 계수로 정함 (segment 가 하나면 0)
+// segment 를 H(x_R) 의 윗 bit 로 정하면 같은 x_R 원소가 hash 마다 한 segment 로 몰려서
+// segment 가 여러 개일 때 cuckoo 용량이 무너진다 (2^r 개 x_R 을 segment 끼리 나눠 가짐).
+// 위치에서 x_L 이 나오므로 segment 가 x 의 어떤 함수여도 (bin, x_R, hash) -> x 는 하나.
+class PermPlacement {
+public:
+    PermPlacement(size_t bins, size_t r) : bins_(bins), r_(r) {
+        if (r_ >= kElementBits) throw std::invalid_argument("r must be smaller than the element bits");
+        const size_t full = size_t(1) << (kElementBits - r_);
+        segment_bins_ = bins_ < full ? bins_ : full;
+        if (segment_bins_ == 0 || bins_ % segment_bins_ != 0)
+            throw std::invalid_argument("bins must be a multiple of 2^(22 - r)");
+        num_segments_ = bins_ / segment_bins_;
+    }
+
+    // h = H(x_R) (hash 함수 p 로 계산한 값)
+    size_t bin(uint32_t x_l, uint32_t x_r, uint64_t h, const HashParams& p) const {
+        size_t pos = (x_l ^ h) % segment_bins_;
+        if (num_segments_ == 1) return pos;
+        return segment((uint64_t(x_l) << r_) | x_r, p) * segment_bins_ + pos;
+    }
+
+    uint32_t x_l(size_t bin, uint64_t h) const {
+        return static_cast<uint32_t>((bin % segment_bins_) ^ (h % segment_bins_));
+    }
+
+private:
+    size_t segment(uint64_t x, const HashParams& p) const {
+        uint64_t v = (x ^ (p.seed << 24)) * 0x9e3779b97f4a7c15ULL + p.c0;
+        v ^= v >> 29;
+        v *= 0xbf58476d1ce4e5b9ULL;
+        v ^= v >> 32;
+        return static_cast<size_t>(v % num_segments_);
+    }
+
+    size_t bins_;
+    size_t r_;
+    size_t segment_bins_;
+    size_t num_segments_;
+};
@@ -12,7 +12,7 @@ PermCuckooTable::PermCuckooTable(
 )
     : num_bins_(num_bins), threshold_(threshold),
       num_hash_functions_(hash_indices.size()), r_(r), mask_r_((1U << r) - 1),
-      table_(num_bins, std::nullopt)
+      placement_(num_bins, r), table_(num_bins, std::nullopt)
 {
     for (size_t idx : hash_indices) {
         hash_functions_.push_back(all_hashes[idx]);
@@ -36,8 +36,8 @@ bool PermCuckooTable::insert(uint32_t value) {
     size_t which_fn = 0;
 
     for (size_t reloc = 0; reloc < threshold_; ++reloc) {
-        size_t bin = cur_l ^ universal_hash(hash_functions_[which_fn], cur_r);
-        bin %= num_bins_;
+        const HashParams& h = hash_functions_[which_fn];
+        size_t bin = placement_.bin(cur_l, cur_r, universal_hash(h, cur_r), h);
         if (!table_[bin].has_value()) {
             table_[bin] = TableEntry{cur_r, which_fn};
             return true;
@@ -46,13 +46,20 @@ bool PermCuckooTable::insert(uint32_t value) {
         TableEntry prev = table_[bin].value();
         table_[bin] = TableEntry{cur_r, which_fn};
         cur_r = prev.x_r;
-        // which_fn displacement: 실제 이전 hash idx를 이어감
-        cur_l = bin ^ universal_hash(hash_functions_[prev.hash_idx], cur_r);
-        which_fn = (which_fn + 1) % num_hash_functions_;
+        cur_l = placement_.x_l(bin, universal_hash(hash_functions_[prev.hash_idx], cur_r));
+        // 쫓겨난 원소는 자기가 쓰던 hash 의 다음 hash 로 (방금 넣은 원소의 hash 를 기준으로 하면
+        // 쫓겨난 원소가 같은 bin 으로 돌아가서 두 원소가 서로 밀어내기만 함)
+        which_fn = (prev.hash_idx + 1) % num_hash_functions_;
     }
     return false; // insertion failed
 }
 
+uint32_t PermCuckooTable::recover_element(size_t bin) const {
+    const TableEntry& entry = table_[bin].value();
+    uint64_t x_l = placement_.x_l(bin, universal_hash(hash_functions_[entry.hash_idx], entry.x_r));
+    return static_cast<uint32_t>((x_l << r_) | entry.x_r);
+}
+
 size_t PermCuckooTable::insert_all(const std::vector<uint32_t>& elements) {
     size_t fail_count = 0;
     for (auto v : elements) {
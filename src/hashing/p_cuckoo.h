@@ -35,12 +35,19 @@ public:
 
     uint64_t universal_hash(const HashParams& p, uint32_t value) const;
 
+    // bin 에 들어있는 원래 원소 x 복원: x_L = bin ^ H_{hash_idx}(x_R), x = x_L << r | x_R
+    // (bin 이 비어있으면 안 됨)
+    uint32_t recover_element(size_t bin) const;
+
+    size_t r() const { return r_; }
+
 private:
     size_t num_bins_;
     size_t threshold_;
     size_t num_hash_functions_;
     size_t r_; // x를 분할할 하위 비트 개수
     uint32_t mask_r_; // x_R 추출용 마스크
+    PermPlacement placement_;
 
     std::vector<HashParams> hash_functions_;
     std::vector<std::string> hash_names_;
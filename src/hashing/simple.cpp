@@ -1,5 +1,7 @@
 #include "simple.h"
 #include <algorithm>
+#include <iterator>
+#include <stdexcept>
 
 SimpleHashTable::SimpleHashTable(size_t bins, const std::vector<HashParams>& hash_functions)
     : hash_functions_(hash_functions), num_bins_(bins), table_(bins) {}
@@ -56,10 +58,12 @@ std::vector<seal::Ciphertext> batch_encrypt_simple_table(
     return result;
 }
 
-std::vector<seal::Plaintext> encode_simple_table(
-    const std::vector<std::vector<uint32_t>>& simple_table,
-    seal::BatchEncoder& batch_encoder,
-    uint32_t placeholder)
+// uint32_t / uint64_t (packed slot) table 공용 구현
+template <class T>
+static std::vector<seal::Plaintext> encode_simple_table_impl(
+    const std::vector<std::vector<T>>& simple_table,
+    const seal::BatchEncoder& batch_encoder,
+    T placeholder)
 {
     size_t bins = simple_table.size();
     size_t max_load = 0;
@@ -80,9 +84,10 @@ std::vector<seal::Plaintext> encode_simple_table(
     return result;
 }
 
-std::vector<std::vector<uint32_t>> pad_simple_table_vec(
-    const std::vector<std::vector<uint32_t>>& table,
-    uint32_t placeholder
+template <class T>
+static std::vector<std::vector<T>> pad_simple_table_vec_impl(
+    const std::vector<std::vector<T>>& table,
+    T placeholder
 ) {
     // 먼저 max_load 구하기
     size_t max_load = 0;
@@ -91,11 +96,11 @@ std::vector<std::vector<uint32_t>> pad_simple_table_vec(
     }
 
     // 새 테이블 만들기
-    std::vector<std::vector<uint32_t>> padded_table;
+    std::vector<std::vector<T>> padded_table;
     padded_table.reserve(table.size());
 
     for (const auto& bin : table) {
-        std::vector<uint32_t> padded_bin = bin;
+        std::vector<T> padded_bin = bin;
         while (padded_bin.size() < max_load) {
             padded_bin.push_back(placeholder);
         }
@@ -105,8 +110,56 @@ std::vector<std::vector<uint32_t>> pad_simple_table_vec(
     return padded_table;
 }
 
+std::vector<seal::Plaintext> encode_simple_table(
+    const std::vector<std::vector<uint32_t>>& simple_table,
+    const seal::BatchEncoder& batch_encoder,
+    uint32_t placeholder)
+{
+    return encode_simple_table_impl(simple_table, batch_encoder, placeholder);
+}
+
+std::vector<seal::Plaintext> encode_simple_table(
+    const std::vector<std::vector<uint64_t>>& simple_table,
+    const seal::BatchEncoder& batch_encoder,
+    uint64_t placeholder)
+{
+    return encode_simple_table_impl(simple_table, batch_encoder, placeholder);
+}
+
+std::vector<std::vector<uint32_t>> pad_simple_table_vec(
+    const std::vector<std::vector<uint32_t>>& table,
+    uint32_t placeholder
+) {
+    return pad_simple_table_vec_impl(table, placeholder);
+}
+
+std::vector<std::vector<uint64_t>> pad_simple_table_vec(
+    const std::vector<std::vector<uint64_t>>& table,
+    uint64_t placeholder
+) {
+    return pad_simple_table_vec_impl(table, placeholder);
+}
+
+std::vector<std::vector<std::vector<uint64_t>>> split_simple_table_segments(
+    std::vector<std::vector<uint64_t>> table,
+    size_t segment_bins
+) {
+    if (segment_bins == 0 || table.size() % segment_bins != 0)
+        throw std::invalid_argument("table size must be a multiple of segment_bins");
+
+    size_t num_segments = table.size() / segment_bins;
+    std::vector<std::vector<std::vector<uint64_t>>> segments(num_segments);
+    for (size_t seg = 0; seg < num_segments; ++seg) {
+        auto first = table.begin() + seg * segment_bins;
+        segments[seg].assign(std::make_move_iterator(first),
+                             std::make_move_iterator(first + segment_bins));
+    }
+    return segments;
+}
+
 PermSimpleHashTable::PermSimpleHashTable(size_t bins, size_t r, const std::vector<HashParams>& hash_functions)
-    : hash_functions_(hash_functions), num_bins_(bins), r_(r), mask_r_((1U << r) - 1), table_(bins)
+    : hash_functions_(hash_functions), num_bins_(bins), r_(r), mask_r_((1U << r) - 1),
+      placement_(bins, r), table_(bins)
 {}
 
 uint64_t PermSimpleHashTable::universal_hash(const HashParams& p, uint32_t value) const {
@@ -120,8 +173,7 @@ void PermSimpleHashTable::insert(uint32_t value) {
     uint32_t x_l = value >> r_;
     uint32_t x_r = value & mask_r_;
     for (const auto& hash_p : hash_functions_) {
-        size_t bin = x_l ^ universal_hash(hash_p, x_r);
-        bin %= num_bins_; // 안전하게 mod
+        size_t bin = placement_.bin(x_l, x_r, universal_hash(hash_p, x_r), hash_p);
         table_[bin].push_back(x_r); // x_R만 저장
     }
 }
@@ -135,6 +187,13 @@ const std::vector<std::vector<uint32_t>>& PermSimpleHashTable::get_table() const
     return table_;
 }
 
+uint32_t PermSimpleHashTable::recover_element(size_t bin, uint32_t x_r) const {
+    if (hash_functions_.size() != 1)
+        throw std::logic_error("recover_element needs a single-hash table");
+    uint64_t x_l = placement_.x_l(bin, universal_hash(hash_functions_.front(), x_r));
+    return static_cast<uint32_t>((x_l << r_) | x_r);
+}
+
 std::vector<SimpleHashTable>
 build_simple_tables_for_hashes(
     size_t bins,
@@ -44,7 +44,7 @@ std::vector<seal::Ciphertext> batch_encrypt_simple_table(
 
 std::vector<seal::Plaintext> encode_simple_table(
     const std::vector<std::vector<uint32_t>>& simple_table,
-    seal::BatchEncoder& batch_encoder,
+    const seal::BatchEncoder& batch_encoder,
     uint32_t placeholder = 0
 );
 
@@ -53,6 +53,25 @@ std::vector<std::vector<uint32_t>> pad_simple_table_vec(
     uint32_t placeholder = 0
 );
 
+// SlotPacker 로 pack 된 table (slot 하나에 d 개 lane) 용
+std::vector<seal::Plaintext> encode_simple_table(
+    const std::vector<std::vector<uint64_t>>& simple_table,
+    const seal::BatchEncoder& batch_encoder,
+    uint64_t placeholder = 0
+);
+
+std::vector<std::vector<uint64_t>> pad_simple_table_vec(
+    const std::vector<std::vector<uint64_t>>& table,
+    uint64_t placeholder = 0
+);
+
+// table 을 segment_bins 개 bin 단위로 나눔 (client query ciphertext 하나당 segment 하나).
+// segment 마다 따로 pad/encode 하므로 row 개수는 segment 별 max_load 를 따름
+std::vector<std::vector<std::vector<uint64_t>>> split_simple_table_segments(
+    std::vector<std::vector<uint64_t>> table,
+    size_t segment_bins
+);
+
 // Permutation-based simple hash table
 class PermSimpleHashTable {
 public:
@@ -64,11 +83,15 @@ public:
     // x_R만 저장된 테이블
     const std::vector<std::vector<uint32_t>>& get_table() const;
 
+    // bin 에 들어있는 x_R 의 원래 원소 (hash 하나로 만든 table 용, labeled mode 에서 label 조회)
+    uint32_t recover_element(size_t bin, uint32_t x_r) const;
+
 private:
     std::vector<HashParams> hash_functions_;
     size_t num_bins_;
     size_t r_;
     uint32_t mask_r_;
+    PermPlacement placement_;
     std::vector<std::vector<uint32_t>> table_;
 
     uint64_t universal_hash(const HashParams& p, uint32_t value) const;
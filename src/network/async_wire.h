@@ -0,0 +1,458 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "wire.h"
+
+// epoll 기반 비동기 Wire
+//
+// 연결된 Wire 의 socket 을 잠시 빌려서 non-blocking 으로 바꾸고, event loop thread 하나가
+// epoll 로 송수신을 처리한다. 메시지 형식은 psi_wire.h 와 동일 (u64 / u64 길이 + bytes)
+// 이므로 상대방은 동기 Wire 를 써도 된다.
+//
+//   - send_* : 큐에 넣고 바로 리턴 (future 또는 callback 으로 완료 통지)
+//   - recv_* : 요청 순서대로 메시지를 돌려줌. loop thread 는 요청이 없어도 socket 을
+//              계속 읽어서 rx buffer 에 쌓아둔다 (max_rx_buffer 까지) -> 계산 중에도 TCP
+//              window 가 닫히지 않음.
+//   - callback 은 loop thread 에서 호출되므로 이 AsyncWire 의 future 를 기다리면 안 됨.
+//
+// detach() (또는 소멸자) 에서 남은 send 를 모두 보내고 socket 을 blocking 으로 되돌린 뒤
+// 송수신 byte/시간을 원래 Wire 통계에 더한다. 이후 Wire 를 다시 동기로 써도 되지만,
+// 상대가 더 보낸 bytes 를 미리 읽어버렸으면 detach() 가 예외를 던진다.
+class AsyncWire {
+public:
+    using SendCallback = std::function<void(std::exception_ptr)>;
+    using RecvCallback = std::function<void(std::vector<uint8_t>, std::exception_ptr)>;
+
+    explicit AsyncWire(Wire& wire, size_t max_rx_buffer = size_t(64) << 20)
+        : wire_(wire), fd_(wire.fd()), max_rx_buffer_(max_rx_buffer)
+    {
+        if (!wire.pollable())
+            throw std::invalid_argument("AsyncWire needs a socket-backed Wire");
+        wire_.flush();   // Wire buffer 에 남은 bytes 가 먼저 나가야 순서가 맞음
+
+        saved_flags_ = checked(::fcntl(fd_, F_GETFL), "fcntl(F_GETFL)");
+        checked(::fcntl(fd_, F_SETFL, saved_flags_ | O_NONBLOCK), "fcntl(F_SETFL)");
+
+        epoll_fd_ = checked(::epoll_create1(EPOLL_CLOEXEC), "epoll_create1");
+        event_fd_ = checked(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), "eventfd");
+
+        epoll_event ev{};
+        ev.events  = EPOLLIN;
+        ev.data.fd = event_fd_;
+        checked(::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &ev), "epoll_ctl(eventfd)");
+
+        ev.events  = EPOLLIN;
+        ev.data.fd = fd_;
+        checked(::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd_, &ev), "epoll_ctl(socket)");
+        interest_ = EPOLLIN;
+
+        loop_thread_ = std::thread([this] { loop(); });
+    }
+
+    AsyncWire(const AsyncWire&)            = delete;
+    AsyncWire& operator=(const AsyncWire&) = delete;
+
+    ~AsyncWire() {
+        try {
+            detach();
+        } catch (...) {
+            // 소멸자에서는 삼킴 (명시적으로 detach() 를 부르면 예외가 전달됨)
+        }
+    }
+
+    // ---- send ----
+    void send_u64(std::uint64_t v, SendCallback cb) {
+        std::vector<uint8_t> buf(sizeof(v));
+        std::memcpy(buf.data(), &v, sizeof(v));
+        enqueue_send(SendReq{{}, 0, std::move(buf), 0, std::move(cb)}, false);
+    }
+
+    void send_bytes(std::vector<uint8_t> buf, SendCallback cb) {
+        SendReq req{{}, 0, std::move(buf), 0, std::move(cb)};
+        std::uint64_t len = req.body.size();
+        std::memcpy(req.header, &len, sizeof(len));
+        enqueue_send(std::move(req), true);
+    }
+
+    std::future<void> send_u64(std::uint64_t v) {
+        auto p = std::make_shared<std::promise<void>>();
+        auto f = p->get_future();
+        send_u64(v, [p](std::exception_ptr e) { complete(*p, e); });
+        return f;
+    }
+
+    std::future<void> send_bytes(std::vector<uint8_t> buf) {
+        auto p = std::make_shared<std::promise<void>>();
+        auto f = p->get_future();
+        send_bytes(std::move(buf), [p](std::exception_ptr e) { complete(*p, e); });
+        return f;
+    }
+
+    // ---- recv ----
+    void recv_u64(std::function<void(std::uint64_t, std::exception_ptr)> cb) {
+        enqueue_recv(RecvReq{false, [cb](std::vector<uint8_t> buf, std::exception_ptr e) {
+            std::uint64_t v = 0;
+            if (!e) std::memcpy(&v, buf.data(), sizeof(v));
+            cb(v, e);
+        }});
+    }
+
+    void recv_bytes(RecvCallback cb) { enqueue_recv(RecvReq{true, std::move(cb)}); }
+
+    std::future<std::uint64_t> recv_u64() {
+        auto p = std::make_shared<std::promise<std::uint64_t>>();
+        auto f = p->get_future();
+        recv_u64([p](std::uint64_t v, std::exception_ptr e) {
+            if (e) p->set_exception(e);
+            else   p->set_value(v);
+        });
+        return f;
+    }
+
+    std::future<std::vector<uint8_t>> recv_bytes() {
+        auto p = std::make_shared<std::promise<std::vector<uint8_t>>>();
+        auto f = p->get_future();
+        recv_bytes([p](std::vector<uint8_t> buf, std::exception_ptr e) {
+            if (e) p->set_exception(e);
+            else   p->set_value(std::move(buf));
+        });
+        return f;
+    }
+
+    // 남은 send 를 다 보내고 loop 종료, socket 을 원래 Wire 에 돌려줌
+    void detach() {
+        if (!loop_thread_.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake();
+        loop_thread_.join();
+
+        std::vector<RecvReq> orphans;
+        size_t leftover = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            orphans.assign(std::make_move_iterator(recv_q_.begin()),
+                           std::make_move_iterator(recv_q_.end()));
+            recv_q_.clear();
+            leftover = rx_buf_.size() - rx_off_;
+        }
+        auto detached = std::make_exception_ptr(std::runtime_error("AsyncWire detached"));
+        for (auto& r : orphans) r.cb({}, detached);
+
+        ::fcntl(fd_, F_SETFL, saved_flags_);
+        ::close(event_fd_);
+        ::close(epoll_fd_);
+        wire_.add_stats(bytes_sent_, bytes_recv_, us_send_, us_recv_);
+
+        if (error_) std::rethrow_exception(error_);
+        if (leftover > 0)
+            throw std::runtime_error("AsyncWire detached with unconsumed received bytes");
+    }
+
+private:
+    struct SendReq {
+        uint8_t header[8];
+        size_t header_len;     // 0 이면 header 없이 body 만 (u64)
+        std::vector<uint8_t> body;
+        size_t off;            // header + body 중 이미 보낸 bytes
+        SendCallback cb;
+    };
+    struct RecvReq {
+        bool framed;           // false: u64 (8 bytes), true: u64 길이 + bytes
+        RecvCallback cb;
+    };
+    using clock       = std::chrono::high_resolution_clock;
+    using Completion  = std::function<void()>;
+
+    static int checked(int ret, const char* msg) {
+        if (ret < 0) {
+            perror(msg);
+            throw std::runtime_error(msg);
+        }
+        return ret;
+    }
+
+    static void complete(std::promise<void>& p, std::exception_ptr e) {
+        if (e) p.set_exception(e);
+        else   p.set_value();
+    }
+
+    void wake() {
+        std::uint64_t one = 1;
+        ssize_t r = ::write(event_fd_, &one, sizeof(one));
+        (void)r;
+    }
+
+    void enqueue_send(SendReq req, bool framed) {
+        req.header_len = framed ? sizeof(req.header) : 0;
+        std::exception_ptr e;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (error_ || stopping_) {
+                e = error_ ? error_
+                           : std::make_exception_ptr(std::runtime_error("AsyncWire detached"));
+            } else {
+                send_q_.push_back(std::move(req));
+            }
+        }
+        if (e) {
+            req.cb(e);
+            return;
+        }
+        wake();
+    }
+
+    void enqueue_recv(RecvReq req) {
+        std::exception_ptr e;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (error_ || stopping_) {
+                e = error_ ? error_
+                           : std::make_exception_ptr(std::runtime_error("AsyncWire detached"));
+            } else {
+                recv_q_.push_back(std::move(req));
+            }
+        }
+        if (e) {
+            req.cb({}, e);
+            return;
+        }
+        wake();
+    }
+
+    // ---- 아래는 모두 loop thread 에서 mutex_ 를 잡은 상태로 호출 ----
+
+    // 보낼 게 없을 때까지 / EAGAIN 까지 전송, 다 보낸 요청의 callback 을 done 에 추가
+    void flush_sends(std::vector<Completion>& done) {
+        while (!send_q_.empty()) {
+            SendReq& req = send_q_.front();
+            iovec iov[2];
+            int iovcnt = 0;
+            size_t total = req.header_len + req.body.size();
+            if (req.off < req.header_len) {
+                iov[iovcnt++] = {req.header + req.off, req.header_len - req.off};
+                if (!req.body.empty())
+                    iov[iovcnt++] = {req.body.data(), req.body.size()};
+            } else if (req.off < total) {
+                iov[iovcnt++] = {req.body.data() + (req.off - req.header_len),
+                                 total - req.off};
+            }
+
+            if (iovcnt > 0) {
+                auto t0 = clock::now();
+                msghdr msg{};
+                msg.msg_iov    = iov;
+                msg.msg_iovlen = static_cast<size_t>(iovcnt);
+                ssize_t r = ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+                us_send_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                                clock::now() - t0).count();
+                if (r < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error("send failed");
+                }
+                req.off += static_cast<size_t>(r);
+                bytes_sent_ += static_cast<std::uint64_t>(r);
+                if (req.off < total) continue;
+            }
+
+            auto cb = std::move(req.cb);
+            send_q_.pop_front();
+            if (cb) done.push_back([cb] { cb(nullptr); });
+        }
+    }
+
+    // rx buffer 를 max_rx_buffer_ (또는 대기 중인 요청이 필요로 하는 만큼) 까지 채움
+    void fill_rx() {
+        for (;;) {
+            size_t buffered = rx_buf_.size() - rx_off_;
+            if (buffered >= max_rx_buffer_ && !front_recv_needs_more()) return;
+
+            if (rx_off_ > 0 && rx_off_ * 2 >= rx_buf_.size()) {
+                rx_buf_.erase(rx_buf_.begin(), rx_buf_.begin() + static_cast<std::ptrdiff_t>(rx_off_));
+                rx_off_ = 0;
+            }
+            size_t old_size = rx_buf_.size();
+            rx_buf_.resize(old_size + kReadChunk);
+
+            auto t0 = clock::now();
+            ssize_t r = ::recv(fd_, rx_buf_.data() + old_size, kReadChunk, 0);
+            us_recv_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                            clock::now() - t0).count();
+
+            if (r < 0) {
+                rx_buf_.resize(old_size);
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+                if (errno == EINTR) continue;
+                throw std::runtime_error("recv failed");
+            }
+            rx_buf_.resize(old_size + static_cast<size_t>(r));
+            if (r == 0) {
+                peer_closed_ = true;
+                return;
+            }
+            bytes_recv_ += static_cast<std::uint64_t>(r);
+        }
+    }
+
+    // 맨 앞 recv 요청을 끝내려면 아직 bytes 가 더 필요한지
+    bool front_recv_needs_more() const {
+        if (recv_q_.empty()) return false;
+        size_t buffered = rx_buf_.size() - rx_off_;
+        if (buffered < sizeof(std::uint64_t)) return true;
+        if (!recv_q_.front().framed) return false;
+        std::uint64_t len;
+        std::memcpy(&len, rx_buf_.data() + rx_off_, sizeof(len));
+        Wire::check_frame_len(len);   // 길이만큼 rx buffer 를 키우기 전에
+        return buffered - sizeof(len) < len;
+    }
+
+    // buffer 에 완성된 메시지를 요청 순서대로 넘김
+    void deliver_recvs(std::vector<Completion>& done) {
+        while (!recv_q_.empty() && !front_recv_needs_more()) {
+            RecvReq req = std::move(recv_q_.front());
+            recv_q_.pop_front();
+
+            const uint8_t* p = rx_buf_.data() + rx_off_;
+            std::vector<uint8_t> msg;
+            if (req.framed) {
+                std::uint64_t len;
+                std::memcpy(&len, p, sizeof(len));
+                msg.assign(p + sizeof(len), p + sizeof(len) + len);
+                rx_off_ += sizeof(len) + len;
+            } else {
+                msg.assign(p, p + sizeof(std::uint64_t));
+                rx_off_ += sizeof(std::uint64_t);
+            }
+            auto cb = std::move(req.cb);
+            auto m  = std::make_shared<std::vector<uint8_t>>(std::move(msg));
+            done.push_back([cb, m] { cb(std::move(*m), nullptr); });
+        }
+        if (rx_off_ == rx_buf_.size()) {
+            rx_buf_.clear();
+            rx_off_ = 0;
+        }
+    }
+
+    // 에러 이후 대기 중인 요청을 모두 실패 처리
+    void fail_all(std::exception_ptr e, std::vector<Completion>& done) {
+        error_ = e;
+        set_interest(0);
+        for (auto& s : send_q_)
+            if (s.cb) {
+                auto cb = std::move(s.cb);
+                done.push_back([cb, e] { cb(e); });
+            }
+        for (auto& r : recv_q_) {
+            auto cb = std::move(r.cb);
+            done.push_back([cb, e] { cb({}, e); });
+        }
+        send_q_.clear();
+        recv_q_.clear();
+    }
+
+    void update_interest() {
+        uint32_t want = 0;
+        if (!peer_closed_ &&
+            (rx_buf_.size() - rx_off_ < max_rx_buffer_ || front_recv_needs_more()))
+            want |= EPOLLIN;
+        if (!send_q_.empty())
+            want |= EPOLLOUT;
+        set_interest(want);
+    }
+
+    // want == 0 이면 epoll 에서 아예 빼둠 (닫힌 socket 의 EPOLLHUP/EPOLLERR 로 loop 가 도는 것 방지)
+    void set_interest(uint32_t want) {
+        if (want == interest_) return;
+
+        epoll_event ev{};
+        ev.events  = want;
+        ev.data.fd = fd_;
+        if (want == 0)           ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd_, nullptr);
+        else if (interest_ == 0) ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd_, &ev);
+        else                     ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd_, &ev);
+        interest_ = want;
+    }
+
+    void loop() {
+        epoll_event events[4];
+        for (;;) {
+            std::vector<Completion> done;
+            bool exit_loop = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) {
+                    try {
+                        flush_sends(done);
+                        fill_rx();
+                        deliver_recvs(done);
+                        if (peer_closed_ && !recv_q_.empty())
+                            throw std::runtime_error("recv failed: connection closed");
+                    } catch (...) {
+                        fail_all(std::current_exception(), done);
+                    }
+                }
+                if (stopping_ && (send_q_.empty() || error_)) exit_loop = true;
+                else if (!error_) update_interest();
+            }
+            for (auto& c : done) c();
+            if (exit_loop) return;
+
+            int n = ::epoll_wait(epoll_fd_, events, 4, -1);
+            for (int i = 0; i < n; ++i) {
+                if (events[i].data.fd == event_fd_) {
+                    std::uint64_t cnt;
+                    ssize_t r = ::read(event_fd_, &cnt, sizeof(cnt));
+                    (void)r;
+                }
+            }
+        }
+    }
+
+    static constexpr size_t kReadChunk = size_t(256) << 10;
+
+    Wire& wire_;
+    int fd_;
+    int saved_flags_ = 0;
+    int epoll_fd_    = -1;
+    int event_fd_    = -1;
+    size_t max_rx_buffer_;
+    uint32_t interest_ = 0;
+    std::thread loop_thread_;
+
+    std::mutex mutex_;
+    std::deque<SendReq> send_q_;
+    std::deque<RecvReq> recv_q_;
+    std::vector<uint8_t> rx_buf_;
+    size_t rx_off_       = 0;
+    bool stopping_       = false;
+    bool peer_closed_    = false;
+    std::exception_ptr error_;
+
+    // loop thread 에서만 갱신, detach() 에서 join 후 읽음
+    std::uint64_t bytes_sent_ = 0;
+    std::uint64_t bytes_recv_ = 0;
+    std::uint64_t us_send_    = 0;
+    std::uint64_t us_recv_    = 0;
+};
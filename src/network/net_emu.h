@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Wire 송신 방향 network emulation (root / tc 없이 재현 가능한 LAN/WAN 측정용)
+//
+//   - bandwidth : token bucket. link 가 이전 데이터를 다 내보낼 때까지 sender 를 재움
+//   - RTT/2     : 다 내보낸 segment 는 delay queue 에 넣고 RTT/2 (+ jitter) 뒤에 실제 socket 으로 씀
+//   - jitter    : [-jitter, +jitter] uniform. TCP 처럼 순서는 유지 (앞 segment 보다 먼저 도착 안 함)
+//
+// 각자 자기 송신 방향만 늦추므로 client 와 server 에 같은 profile 을 주면
+// 왕복 하나가 RTT 만큼 걸린다. jitter 난수는 고정 seed 라 실행마다 같음.
+struct NetProfile {
+    double bandwidth_bps = 0;   // 0: 무제한
+    double rtt_ms        = 0;
+    double jitter_ms     = 0;
+
+    bool enabled() const { return bandwidth_bps > 0 || rtt_ms > 0 || jitter_ms > 0; }
+
+    // "lan" (10 Gbps / 0.2 ms), "wan" (100 Mbps / 80 ms), 또는 "<bandwidth>/<rtt>[/<jitter>]"
+    //   bandwidth: 100mbps, 1gbps, 500kbps, inf ...   rtt/jitter: 80ms, 200us
+    static NetProfile parse(const std::string& spec) {
+        NetProfile p;
+        if (spec.empty() || spec == "none") return p;
+        if (spec == "lan") return parse("10gbps/0.2ms");
+        if (spec == "wan") return parse("100mbps/80ms");
+
+        std::vector<std::string> parts;
+        std::stringstream ss(spec);
+        for (std::string item; std::getline(ss, item, '/');) parts.push_back(item);
+        if (parts.size() < 2 || parts.size() > 3)
+            throw std::invalid_argument("bad --net profile: " + spec + " (lan|wan|<bw>/<rtt>[/<jitter>])");
+
+        p.bandwidth_bps = parse_unit(parts[0], {{"gbps", 1e9}, {"mbps", 1e6}, {"kbps", 1e3}, {"bps", 1}}, spec);
+        p.rtt_ms        = parse_unit(parts[1], {{"ms", 1}, {"us", 1e-3}, {"s", 1e3}}, spec);
+        if (parts.size() == 3)
+            p.jitter_ms = parse_unit(parts[2], {{"ms", 1}, {"us", 1e-3}, {"s", 1e3}}, spec);
+        return p;
+    }
+
+    std::string describe() const {
+        std::ostringstream os;
+        if (bandwidth_bps <= 0)        os << "unlimited";
+        else if (bandwidth_bps >= 1e9) os << bandwidth_bps / 1e9 << " Gbps";
+        else if (bandwidth_bps >= 1e6) os << bandwidth_bps / 1e6 << " Mbps";
+        else                           os << bandwidth_bps / 1e3 << " kbps";
+        os << " / " << rtt_ms << " ms RTT";
+        if (jitter_ms > 0) os << " +-" << jitter_ms << " ms";
+        return os.str();
+    }
+
+private:
+    static double parse_unit(std::string s, std::vector<std::pair<std::string, double>> units,
+                             const std::string& spec)
+    {
+        for (auto& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (s == "inf" || s == "0") return 0;
+        for (const auto& [suffix, scale] : units) {
+            if (s.size() > suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                try {
+                    size_t used = 0;
+                    std::string num = s.substr(0, s.size() - suffix.size());
+                    double v = std::stod(num, &used);
+                    if (used == num.size() && v >= 0) return v * scale;
+                } catch (const std::exception&) {
+                }
+                break;
+            }
+        }
+        throw std::invalid_argument("bad --net profile: " + spec);
+    }
+};
+
+// 한 process 의 송신 link (bandwidth 공유)
+//
+// 같은 process 의 Wire 들 (stripe 연결, daemon 의 session 들) 은 하나의 uplink 를 나눠 쓴다.
+class NetLink {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit NetLink(double bandwidth_bps) : bandwidth_bps_(bandwidth_bps) {}
+
+    // bytes 를 link 에 예약. {전송 시작 시각, 전송 끝 시각}
+    std::pair<clock::time_point, clock::time_point> reserve(size_t bytes) {
+        auto now = clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto start = std::max(now, next_free_);
+        auto end   = start;
+        if (bandwidth_bps_ > 0) {
+            end += std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>(bytes * 8.0 / bandwidth_bps_));
+        }
+        next_free_ = end;
+        return {start, end};
+    }
+
+private:
+    const double bandwidth_bps_;
+    std::mutex mutex_;
+    clock::time_point next_free_{};
+};
+
+// Wire 하나의 송신 delay queue
+//
+// submit() 은 link 를 예약하고 (bandwidth 만큼 sender 를 재우고) 복사본을 queue 에 넣는다.
+// thread 하나가 도착 시각이 된 segment 를 sink (실제 socket / shm write) 로 넘김.
+class NetEmulator {
+public:
+    using clock = NetLink::clock;
+    using Sink  = std::function<void(const uint8_t*, size_t)>;
+
+    static constexpr size_t kSegmentBytes = 64 * 1024;   // pacing / 도착 단위
+
+    NetEmulator(const NetProfile& profile, std::shared_ptr<NetLink> link, Sink sink)
+        : link_(std::move(link)),
+          sink_(std::move(sink)),
+          one_way_(std::chrono::duration<double, std::milli>(profile.rtt_ms / 2)),
+          jitter_(profile.jitter_ms)
+    {
+        thread_ = std::thread([this] { run(); });
+    }
+
+    NetEmulator(const NetEmulator&)            = delete;
+    NetEmulator& operator=(const NetEmulator&) = delete;
+
+    ~NetEmulator() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    void submit(const uint8_t* data, size_t len) {
+        while (len > 0) {
+            size_t n = std::min(len, kSegmentBytes);
+            auto [start, end] = link_->reserve(n);
+            std::this_thread::sleep_until(start);   // link 가 앞 데이터를 내보내는 동안 대기
+
+            double jitter_ms = jitter_ > 0 ? std::uniform_real_distribution<double>(-jitter_, jitter_)(rng_) : 0;
+            auto arrive = end + std::chrono::duration_cast<clock::duration>(
+                              one_way_ + std::chrono::duration<double, std::milli>(jitter_ms));
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (error_) std::rethrow_exception(error_);
+                arrive = std::max(arrive, last_arrive_);
+                last_arrive_ = arrive;
+                queue_.push_back({arrive, std::vector<uint8_t>(data, data + n)});
+            }
+            cv_.notify_all();
+            data += n;
+            len  -= n;
+        }
+    }
+
+    // queue 가 빌 때까지 (모두 상대에게 쓰일 때까지) 대기
+    void drain() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return (queue_.empty() && !writing_) || error_; });
+        if (error_) std::rethrow_exception(error_);
+    }
+
+private:
+    struct Segment {
+        clock::time_point arrive;
+        std::vector<uint8_t> bytes;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) return;   // stop_ 이고 다 보냄
+
+            auto arrive = queue_.front().arrive;
+            if (clock::now() < arrive) {
+                cv_.wait_until(lock, arrive);
+                continue;
+            }
+
+            Segment seg = std::move(queue_.front());
+            queue_.pop_front();
+            writing_ = true;
+            lock.unlock();
+            try {
+                sink_(seg.bytes.data(), seg.bytes.size());
+            } catch (...) {
+                lock.lock();
+                error_   = std::current_exception();
+                writing_ = false;
+                queue_.clear();
+                cv_.notify_all();
+                return;
+            }
+            lock.lock();
+            writing_ = false;
+            cv_.notify_all();
+        }
+    }
+
+    std::shared_ptr<NetLink> link_;
+    Sink sink_;
+    const std::chrono::duration<double, std::milli> one_way_;
+    const double jitter_;
+    std::mt19937_64 rng_{0x5053495f4e4554ULL};   // 고정 seed (재현용)
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Segment> queue_;
+    clock::time_point last_arrive_{};
+    bool writing_ = false;
+    bool stop_    = false;
+    std::exception_ptr error_;
+    std::thread thread_;
+};
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <vector>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 
 #include "../network/wire.h"         // 여기서 Wire 클래스를 가져옴
@@ -25,13 +27,12 @@ inline std::uint64_t recv_u64(Wire& w) {
 }
 
 inline void send_bytes(Wire& w, const std::vector<uint8_t>& buf) {
-    send_u64(w, buf.size());
-    if (!buf.empty())
-        w.send_raw(buf.data(), buf.size());
+    w.send_frame(buf.data(), buf.size());
 }
 
 inline std::vector<uint8_t> recv_bytes(Wire& w) {
     auto len = recv_u64(w);
+    Wire::check_frame_len(len);
     std::vector<uint8_t> buf(len);
     if (len > 0)
         w.recv_raw(buf.data(), len);
@@ -41,12 +42,16 @@ inline std::vector<uint8_t> recv_bytes(Wire& w) {
 // --------- SEAL 객체 직렬화 헬퍼 (내가 말한 send_seal_obj) ---------
 
 template<class T>
-void send_seal_obj(Wire& w, const T& obj) {
+std::vector<uint8_t> serialize_seal_obj(const T& obj) {
     std::stringstream ss;
     obj.save(ss);
     std::string s = ss.str();
-    std::vector<uint8_t> buf(s.begin(), s.end());
-    send_bytes(w, buf);
+    return std::vector<uint8_t>(s.begin(), s.end());
+}
+
+template<class T>
+void send_seal_obj(Wire& w, const T& obj) {
+    send_bytes(w, serialize_seal_obj(obj));
 }
 
 // 1) EncryptionParameters 전용: context 없이 load(stream)
@@ -58,22 +63,24 @@ inline void recv_seal_parms(Wire& w, seal::EncryptionParameters& parms) {
 
 // 2) PublicKey / Ciphertext 등: context가 필요한 버전
 template<class T>
-void recv_seal_obj(Wire& w, T& obj, const seal::SEALContext& context) {
-    auto buf = recv_bytes(w);
+void load_seal_obj(const std::vector<uint8_t>& buf, T& obj, const seal::SEALContext& context) {
     std::stringstream ss(std::string(buf.begin(), buf.end()));
     obj.load(context, ss);   // <- context 필요
 }
 
+template<class T>
+void recv_seal_obj(Wire& w, T& obj, const seal::SEALContext& context) {
+    load_seal_obj(recv_bytes(w), obj, context);
+}
+
 // --------- HashParams 직렬화 (필드에 맞게 조정 필요) ---------
 inline void send_string(Wire& w, const std::string& s) {
-    send_u64(w, static_cast<std::uint64_t>(s.size()));
-    if (!s.empty()) {
-        w.send_raw(reinterpret_cast<const uint8_t*>(s.data()), s.size());
-    }
+    w.send_frame(reinterpret_cast<const uint8_t*>(s.data()), s.size());
 }
 
 inline std::string recv_string(Wire& w) {
     std::uint64_t len = recv_u64(w);
+    Wire::check_frame_len(len);
     std::string s(len, '\0');
     if (len > 0) {
         w.recv_raw(reinterpret_cast<uint8_t*>(&s[0]), len);
@@ -84,32 +91,101 @@ inline std::string recv_string(Wire& w) {
 
 
 
-inline void send_hash_params(Wire& w, const std::vector<HashParams>& hs) {
-    send_u64(w, static_cast<std::uint64_t>(hs.size()));
+// HashParams vector 전체를 하나의 block 으로 묶어서 한 메시지로 전송
+//   [n] { [c0][c1][c2][c3][prime][seed][mod][name_len][name bytes] } * n   (모두 u64, little endian)
+inline std::vector<uint8_t> pack_hash_params(const std::vector<HashParams>& hs) {
+    std::vector<uint8_t> block;
+    auto put_u64 = [&block](std::uint64_t v) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+        block.insert(block.end(), p, p + sizeof(v));
+    };
+
+    put_u64(static_cast<std::uint64_t>(hs.size()));
     for (const auto& h : hs) {
-        send_u64(w, h.c0);
-        send_u64(w, h.c1);
-        send_u64(w, h.c2);
-        send_u64(w, h.c3);
-        send_u64(w, h.prime);
-        send_u64(w, h.seed);
-        send_u64(w, h.mod);
-        send_string(w, h.name);   // 문자열은 길이 + 내용
+        put_u64(h.c0);
+        put_u64(h.c1);
+        put_u64(h.c2);
+        put_u64(h.c3);
+        put_u64(h.prime);
+        put_u64(h.seed);
+        put_u64(h.mod);
+        put_u64(static_cast<std::uint64_t>(h.name.size()));   // 문자열은 길이 + 내용
+        block.insert(block.end(), h.name.begin(), h.name.end());
     }
+    return block;
 }
 
-inline std::vector<HashParams> recv_hash_params(Wire& w) {
-    std::uint64_t n = recv_u64(w);
+inline std::vector<HashParams> unpack_hash_params(const std::vector<uint8_t>& block) {
+    size_t off = 0;
+    auto take = [&block, &off](size_t len) {
+        if (block.size() - off < len)
+            throw std::runtime_error("malformed HashParams block");
+        const uint8_t* p = block.data() + off;
+        off += len;
+        return p;
+    };
+    auto get_u64 = [&take]() {
+        std::uint64_t v;
+        std::memcpy(&v, take(sizeof(v)), sizeof(v));
+        return v;
+    };
+
+    std::uint64_t n = get_u64();
+    if (n > block.size() / (8 * sizeof(std::uint64_t)))
+        throw std::runtime_error("malformed HashParams block");
     std::vector<HashParams> hs(n);
-    for (std::uint64_t i = 0; i < n; ++i) {
-        hs[i].c0    = recv_u64(w);
-        hs[i].c1    = recv_u64(w);
-        hs[i].c2    = recv_u64(w);
-        hs[i].c3    = recv_u64(w);
-        hs[i].prime = recv_u64(w);
-        hs[i].seed  = recv_u64(w);
-        hs[i].mod   = recv_u64(w);
-        hs[i].name  = recv_string(w);
+    for (auto& h : hs) {
+        h.c0    = get_u64();
+        h.c1    = get_u64();
+        h.c2    = get_u64();
+        h.c3    = get_u64();
+        h.prime = get_u64();
+        h.seed  = get_u64();
+        h.mod   = get_u64();
+        std::uint64_t len = get_u64();
+        const uint8_t* p = take(len);
+        h.name.assign(reinterpret_cast<const char*>(p), len);
     }
     return hs;
 }
+
+inline void send_hash_params(Wire& w, const std::vector<HashParams>& hs) {
+    send_bytes(w, pack_hash_params(hs));
+}
+
+inline std::vector<HashParams> recv_hash_params(Wire& w) {
+    return unpack_hash_params(recv_bytes(w));
+}
+
+// --------- query segment 협상 ---------
+// client 는 segment 개수를 보내고 (cuckoo 가 실패하면 두 배로 다시), server 는 이보다 많으면 거절
+constexpr size_t kMaxQuerySegments = 256;
+
+// --------- client key material fingerprint (server 의 context / key cache 용) ---------
+//
+// client 는 setup 맨 앞에 [parms_id][public key fingerprint] 를 보내고, server 는 hash 협상
+// 응답 앞에 cache 에 있는 것 (kHaveContext | kHavePublicKey) 을 알려준다.
+// client 는 없다고 한 것만 chosen_hashes 앞에서 전체를 보냄.
+// 그 바로 뒤에 label bit 수 (0: unlabeled, protocol/labels.h) 가 따라옴.
+constexpr std::uint64_t kHaveContext   = 1;
+constexpr std::uint64_t kHavePublicKey = 2;
+
+// 직렬화된 bytes 의 FNV-1a 64-bit (cache key 용, 보안 목적 아님)
+inline std::uint64_t fingerprint_bytes(const std::vector<uint8_t>& buf) {
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (uint8_t b : buf) {
+        h ^= b;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+inline void send_parms_id(Wire& w, const seal::parms_id_type& id) {
+    for (auto v : id) send_u64(w, v);
+}
+
+inline seal::parms_id_type recv_parms_id(Wire& w) {
+    seal::parms_id_type id{};
+    for (auto& v : id) v = recv_u64(w);
+    return id;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "wire.h"
+#include "psi_wire.h"
+#include "../util/trace.h"
+
+// 계산 thread 와 전송 thread 를 분리하는 producer/consumer pipeline.
+//
+// producer (평가 thread) 가 결과를 직렬화해서 넣으면 전용 I/O thread 가 Wire 로 보낸다.
+// 큐에 쌓일 수 있는 메시지는 max_in_flight 개로 제한 (넘으면 producer 가 대기).
+// max_in_flight == 0 이면 thread 없이 push 에서 바로 전송 (기존 동기 방식).
+//
+// pipeline 이 살아있는 동안에는 다른 thread 가 같은 Wire 로 send 하면 안 됨.
+// finish() 후에 Wire 를 다시 직접 써도 됨.
+// trace 가 있으면 전송 ("send", trace_lane) 과 producer 대기 ("queue full") 를 span 으로 기록.
+class SendPipeline {
+public:
+    SendPipeline(Wire& wire, size_t max_in_flight, TraceRecorder* trace = nullptr, int trace_lane = 0)
+        : wire_(wire), max_in_flight_(max_in_flight), trace_(trace), trace_lane_(trace_lane)
+    {
+        if (max_in_flight_ > 0)
+            io_thread_ = std::thread([this] { io_loop(); });
+    }
+
+    SendPipeline(const SendPipeline&)            = delete;
+    SendPipeline& operator=(const SendPipeline&) = delete;
+
+    ~SendPipeline() {
+        try {
+            finish();
+        } catch (...) {
+            // 소멸자에서는 삼킴 (명시적으로 finish() 를 부르면 예외가 전달됨)
+        }
+    }
+
+    void push_u64(std::uint64_t v) { push(Message{true, v, {}}); }
+
+    void push_bytes(std::vector<uint8_t> buf) { push(Message{false, 0, std::move(buf)}); }
+
+    // 직렬화는 호출한 thread 에서 수행
+    template <class T>
+    void push_seal_obj(const T& obj) { push_bytes(serialize_seal_obj(obj)); }
+
+    // 큐가 빌 때까지 기다리고 I/O thread 종료 + Wire buffer flush.
+    // I/O 에러가 있었으면 여기서 다시 던짐
+    void finish() {
+        if (io_thread_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed_ = true;
+            }
+            not_empty_.notify_one();
+            io_thread_.join();
+        }
+        rethrow_if_failed();
+        wire_.flush();
+    }
+
+    // 아직 전송 안 된 메시지 개수
+    size_t queued() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size();
+    }
+
+    // 전송 thread 가 기다린 시간 (큐가 비어서 = 계산이 늦어서)
+    std::uint64_t io_idle_us() const { return io_idle_us_; }
+    // producer 가 기다린 시간 (큐가 가득 차서 = 전송이 늦어서)
+    std::uint64_t producer_blocked_us() const { return producer_blocked_us_; }
+
+private:
+    struct Message {
+        bool is_u64;
+        std::uint64_t v;
+        std::vector<uint8_t> buf;
+    };
+    using clock = std::chrono::steady_clock;
+
+    void send_now(const Message& m) {
+        if (m.is_u64) {
+            send_u64(wire_, m.v);
+            return;
+        }
+        TraceSpan span(trace_, "send", "io", io_thread_.joinable() ? trace_lane_ : 0);   // 동기 전송이면 호출 thread
+        if (span.enabled()) span.set_args(JsonObject().add("bytes", m.buf.size()));
+        send_bytes(wire_, m.buf);
+    }
+
+    void push(Message m) {
+        if (max_in_flight_ == 0) {
+            send_now(m);
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto t0 = clock::now();
+        bool full = queue_.size() >= max_in_flight_;
+        not_full_.wait(lock, [this] { return queue_.size() < max_in_flight_ || error_; });
+        auto t1 = clock::now();
+        producer_blocked_us_ += std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+        if (trace_ && full) trace_->add("queue full", "io", t0, t1);
+        if (error_) {
+            lock.unlock();
+            rethrow_if_failed();
+        }
+        queue_.push_back(std::move(m));
+        lock.unlock();
+        not_empty_.notify_one();
+    }
+
+    void io_loop() {
+        for (;;) {
+            Message m;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                auto t0 = clock::now();
+                not_empty_.wait(lock, [this] { return !queue_.empty() || closed_; });
+                io_idle_us_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                                   clock::now() - t0).count();
+                if (queue_.empty()) return;   // closed_ && 다 보냄
+                m = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            not_full_.notify_one();
+
+            try {
+                send_now(m);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                error_ = std::current_exception();
+                queue_.clear();
+                not_full_.notify_all();
+                return;
+            }
+        }
+    }
+
+    void rethrow_if_failed() {
+        std::exception_ptr e;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            e = error_;
+        }
+        if (e) std::rethrow_exception(e);
+    }
+
+    Wire& wire_;
+    size_t max_in_flight_;
+    TraceRecorder* trace_;
+    int trace_lane_;
+    std::thread io_thread_;
+
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<Message> queue_;
+    bool closed_ = false;
+    std::exception_ptr error_;
+
+    std::uint64_t io_idle_us_          = 0;
+    std::uint64_t producer_blocked_us_ = 0;
+};
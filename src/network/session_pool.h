@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "wire.h"
+
+// daemon 모드용 worker pool
+//
+// accept loop 가 연결을 submit 하면 num_workers 개 thread 중 하나가 handler 로 session 을
+// 처리한다. 대기 중인 연결은 max_queued 개까지만 들고 있고, 넘으면 submit 이 block 되어
+// 나머지는 kernel listen backlog 에서 기다린다.
+// session 하나가 예외로 끝나도 로그만 남기고 다음 연결을 받는다.
+class SessionPool {
+public:
+    using Handler = std::function<void(Wire&, std::uint64_t session_id)>;
+
+    SessionPool(size_t num_workers, size_t max_queued, Handler handler)
+        : max_queued_(max_queued == 0 ? 1 : max_queued), handler_(std::move(handler))
+    {
+        if (num_workers == 0) num_workers = 1;
+        for (size_t i = 0; i < num_workers; ++i)
+            workers_.emplace_back([this] { worker_loop(); });
+    }
+
+    SessionPool(const SessionPool&)            = delete;
+    SessionPool& operator=(const SessionPool&) = delete;
+
+    // 대기 중인 session 을 모두 처리한 뒤 종료
+    ~SessionPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        not_empty_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+
+    void submit(std::unique_ptr<Wire> wire) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return queue_.size() < max_queued_; });
+        queue_.push_back({next_id_++, std::move(wire)});
+        lock.unlock();
+        not_empty_.notify_one();
+    }
+
+    size_t num_workers() const { return workers_.size(); }
+    std::uint64_t completed() const { return completed_; }
+    std::uint64_t failed() const { return failed_; }
+
+private:
+    struct Session {
+        std::uint64_t id;
+        std::unique_ptr<Wire> wire;
+    };
+
+    void worker_loop() {
+        for (;;) {
+            Session s;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                not_empty_.wait(lock, [this] { return !queue_.empty() || closed_; });
+                if (queue_.empty()) return;
+                s = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            not_full_.notify_one();
+
+            try {
+                handler_(*s.wire, s.id);
+                ++completed_;
+            } catch (const std::exception& e) {
+                ++failed_;
+                std::cerr << "[session " << s.id << "] failed: " << e.what() << "\n";
+            }
+        }
+    }
+
+    size_t max_queued_;
+    Handler handler_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<Session> queue_;
+    bool closed_ = false;
+    std::uint64_t next_id_ = 0;
+
+    std::atomic<std::uint64_t> completed_{0};
+    std::atomic<std::uint64_t> failed_{0};
+};
+
+// accept_fn 으로 연결을 계속 받아 pool 에 넘김 (리턴하지 않음).
+// client 가 중간에 끊어도 daemon 이 SIGPIPE 로 죽지 않도록 무시
+[[noreturn]] inline void serve_forever(
+    const std::function<std::unique_ptr<Wire>()>& accept_fn, SessionPool& pool)
+{
+    std::signal(SIGPIPE, SIG_IGN);
+    for (;;) {
+        try {
+            pool.submit(accept_fn());
+        } catch (const std::exception& e) {
+            // 연결 설정 (shm handshake 등) 실패는 해당 연결만 버림
+            std::cerr << "[daemon] accept failed: " << e.what() << "\n";
+        }
+    }
+}
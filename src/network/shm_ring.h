@@ -0,0 +1,271 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+#include <linux/futex.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// 같은 host 의 두 process 사이 shared-memory 전송
+//
+// memfd 하나에 방향별 SPSC byte ring 두 개 (client->server, server->client) 를 둔다.
+// 데이터는 mmap 된 영역으로 memcpy 만 하고 kernel 을 거치지 않음.
+// 상대가 기다리고 있을 때만 futex 로 깨우므로 큰 ciphertext 는 syscall 없이 지나간다.
+//
+// ring header (head / tail / capacity) 는 상대 process 도 쓸 수 있는 memory 이므로 믿지 않는다:
+// capacity 는 연결할 때 확인한 값을 따로 들고 있고, head / tail 은 읽을 때마다 0 <= head - tail <= cap
+// 인지 확인해서 아니면 runtime_error (ring 밖으로 memcpy 하지 않음).
+//
+// 연결 설정과 생존 확인은 AF_UNIX control socket 으로:
+//   server 가 memfd 를 만들어 SCM_RIGHTS 로 client 에 넘기고,
+//   ring 이 비어서/가득 차서 오래 기다리면 control socket 이 끊겼는지 확인한다.
+class ShmChannel {
+public:
+    static constexpr size_t kDefaultRingBytes = size_t(16) << 20;
+
+    // server: memfd 생성 + ring 초기화 후 control socket 으로 fd 전달
+    static std::unique_ptr<ShmChannel> create_and_send(int ctrl_fd, size_t ring_bytes = kDefaultRingBytes) {
+        int mfd = ::memfd_create("pcpsi-shm", MFD_CLOEXEC);
+        if (mfd < 0) throw std::runtime_error("memfd_create failed");
+
+        size_t total = 2 * (kHeaderBytes + ring_bytes);
+        if (::ftruncate(mfd, static_cast<off_t>(total)) < 0) {
+            ::close(mfd);
+            throw std::runtime_error("ftruncate(shm) failed");
+        }
+        void* base = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, mfd, 0);
+        if (base == MAP_FAILED) {
+            ::close(mfd);
+            throw std::runtime_error("mmap(shm) failed");
+        }
+        for (int i = 0; i < 2; ++i) {
+            auto* hdr = new (static_cast<uint8_t*>(base) + i * (kHeaderBytes + ring_bytes)) RingHeader();
+            hdr->capacity = ring_bytes;
+        }
+
+        // fd 를 1 byte payload 와 함께 전송
+        char dummy = 'S';
+        iovec iov{&dummy, 1};
+        alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(int))] = {};
+        msghdr msg{};
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+        cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type  = SCM_RIGHTS;
+        cm->cmsg_len   = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cm), &mfd, sizeof(int));
+        ssize_t r = ::sendmsg(ctrl_fd, &msg, MSG_NOSIGNAL);
+        ::close(mfd);
+        if (r != 1) {
+            ::munmap(base, total);
+            throw std::runtime_error("sending shm fd failed");
+        }
+        // server: ring 0 으로 받고 ring 1 로 보냄
+        return std::unique_ptr<ShmChannel>(new ShmChannel(ctrl_fd, base, total, ring_bytes, /*rx=*/0));
+    }
+
+    // client: control socket 으로 memfd 를 받아서 mmap
+    static std::unique_ptr<ShmChannel> receive(int ctrl_fd) {
+        char dummy = 0;
+        iovec iov{&dummy, 1};
+        alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(int))] = {};
+        msghdr msg{};
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+        if (::recvmsg(ctrl_fd, &msg, MSG_CMSG_CLOEXEC) != 1)
+            throw std::runtime_error("receiving shm fd failed");
+        cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+        if (!cm || cm->cmsg_type != SCM_RIGHTS)
+            throw std::runtime_error("server did not send a shm fd");
+        int mfd;
+        std::memcpy(&mfd, CMSG_DATA(cm), sizeof(int));
+
+        off_t total = ::lseek(mfd, 0, SEEK_END);
+        void* base = total > 0
+            ? ::mmap(nullptr, static_cast<size_t>(total), PROT_READ | PROT_WRITE, MAP_SHARED, mfd, 0)
+            : MAP_FAILED;
+        ::close(mfd);
+        if (base == MAP_FAILED) throw std::runtime_error("mmap(shm) failed");
+
+        size_t ring_bytes = static_cast<RingHeader*>(base)->capacity;
+        if (ring_bytes == 0 || 2 * (kHeaderBytes + ring_bytes) != static_cast<size_t>(total)) {
+            ::munmap(base, static_cast<size_t>(total));
+            throw std::runtime_error("unexpected shm layout");
+        }
+        return std::unique_ptr<ShmChannel>(
+            new ShmChannel(ctrl_fd, base, static_cast<size_t>(total), ring_bytes, /*rx=*/1));
+    }
+
+    ShmChannel(const ShmChannel&)            = delete;
+    ShmChannel& operator=(const ShmChannel&) = delete;
+
+    ~ShmChannel() {
+        tx_->closed.store(1);
+        wake(tx_->data_seq);
+        ::munmap(base_, total_);
+    }
+
+    void write(const uint8_t* data, size_t len) {
+        const size_t cap = ring_bytes_;
+        while (len > 0) {
+            uint64_t head = tx_->head.load(std::memory_order_relaxed);
+            uint64_t tail = tx_->tail.load(std::memory_order_acquire);
+            check_indices(head, tail);
+            size_t free_bytes = cap - static_cast<size_t>(head - tail);
+            if (free_bytes == 0) {
+                wait_for(tx_, tx_->space_seq, tx_->writer_waiting, [&] {
+                    return tx_->tail.load() != tail;
+                });
+                continue;
+            }
+
+            size_t n   = len < free_bytes ? len : free_bytes;
+            size_t pos = static_cast<size_t>(head % cap);
+            size_t first = n < cap - pos ? n : cap - pos;
+            std::memcpy(tx_data_ + pos, data, first);
+            std::memcpy(tx_data_, data + first, n - first);
+            tx_->head.store(head + n, std::memory_order_release);
+
+            tx_->data_seq.fetch_add(1);
+            if (tx_->reader_waiting.exchange(0)) wake(tx_->data_seq);
+
+            data += n;
+            len  -= n;
+        }
+    }
+
+    // 이후 read 가 timeout 안에 데이터를 못 받으면 runtime_error (0 이면 무한 대기)
+    void set_read_timeout(std::chrono::milliseconds timeout) { read_timeout_ = timeout; }
+
+    void read(uint8_t* data, size_t len) {
+        const size_t cap = ring_bytes_;
+        const auto deadline = read_timeout_.count() > 0
+            ? std::chrono::steady_clock::now() + read_timeout_
+            : std::chrono::steady_clock::time_point::max();
+        while (len > 0) {
+            uint64_t tail = rx_->tail.load(std::memory_order_relaxed);
+            uint64_t head = rx_->head.load(std::memory_order_acquire);
+            check_indices(head, tail);
+            size_t avail = static_cast<size_t>(head - tail);
+            if (avail == 0) {
+                if (rx_->closed.load()) throw std::runtime_error("recv failed: shm peer closed");
+                wait_for(rx_, rx_->data_seq, rx_->reader_waiting, [&] {
+                    return rx_->head.load() != head || rx_->closed.load();
+                }, deadline);
+                continue;
+            }
+
+            size_t n   = len < avail ? len : avail;
+            size_t pos = static_cast<size_t>(tail % cap);
+            size_t first = n < cap - pos ? n : cap - pos;
+            std::memcpy(data, rx_data_ + pos, first);
+            std::memcpy(data + first, rx_data_, n - first);
+            rx_->tail.store(tail + n, std::memory_order_release);
+
+            rx_->space_seq.fetch_add(1);
+            if (rx_->writer_waiting.exchange(0)) wake(rx_->space_seq);
+
+            data += n;
+            len  -= n;
+        }
+    }
+
+private:
+    struct RingHeader {
+        alignas(64) std::atomic<uint64_t> head{0};        // writer 가 쓴 총 bytes
+        alignas(64) std::atomic<uint64_t> tail{0};        // reader 가 읽은 총 bytes
+        alignas(64) std::atomic<uint32_t> data_seq{0};    // reader 용 futex word
+        std::atomic<uint32_t> space_seq{0};               // writer 용 futex word
+        std::atomic<uint32_t> reader_waiting{0};
+        std::atomic<uint32_t> writer_waiting{0};
+        std::atomic<uint32_t> closed{0};                  // writer 쪽이 닫힘
+        uint64_t capacity = 0;
+    };
+    static constexpr size_t kHeaderBytes = 4096;
+    static_assert(sizeof(RingHeader) <= kHeaderBytes, "ring header must fit in one page");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "futex word must be lock-free");
+
+    // 상대가 head / tail 을 망가뜨렸으면 (tail > head 이면 unsigned 차가 커짐) 더 읽고 쓰지 않음
+    void check_indices(uint64_t head, uint64_t tail) const {
+        if (head - tail > ring_bytes_) throw std::runtime_error("shm ring corrupted: invalid head/tail");
+    }
+
+    ShmChannel(int ctrl_fd, void* base, size_t total, size_t ring_bytes, int rx_idx)
+        : ctrl_fd_(ctrl_fd), base_(base), total_(total), ring_bytes_(ring_bytes)
+    {
+        auto ring = [&](int i) { return static_cast<uint8_t*>(base) + i * (kHeaderBytes + ring_bytes); };
+        rx_      = reinterpret_cast<RingHeader*>(ring(rx_idx));
+        tx_      = reinterpret_cast<RingHeader*>(ring(1 - rx_idx));
+        rx_data_ = ring(rx_idx) + kHeaderBytes;
+        tx_data_ = ring(1 - rx_idx) + kHeaderBytes;
+    }
+
+    static void wake(std::atomic<uint32_t>& word) {
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    }
+
+    // 잠깐 spin 한 뒤 futex 로 대기. 100ms 마다 control socket 으로 상대가 살아있는지 확인
+    // (deadline 이 지났으면 예외)
+    template <class Ready>
+    void wait_for(RingHeader* ring, std::atomic<uint32_t>& word,
+                  std::atomic<uint32_t>& waiting, Ready ready,
+                  std::chrono::steady_clock::time_point deadline =
+                      std::chrono::steady_clock::time_point::max())
+    {
+        for (int i = 0; i < 256; ++i) {
+            if (ready()) return;
+        }
+        for (;;) {
+            waiting.store(1);
+            uint32_t seq = word.load();
+            if (ready()) {
+                waiting.store(0);
+                return;
+            }
+            timespec ts{0, 100 * 1000 * 1000};
+            long r = ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT,
+                               seq, &ts, nullptr, 0);
+            if (r < 0 && errno == ETIMEDOUT && !peer_alive(ring)) {
+                throw std::runtime_error("shm peer disconnected");
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                waiting.store(0);
+                throw std::runtime_error("recv timed out");
+            }
+            if (ready()) return;
+        }
+    }
+
+    bool peer_alive(RingHeader* ring) const {
+        if (ring->closed.load()) return false;
+        pollfd p{ctrl_fd_, POLLRDHUP, 0};
+        if (::poll(&p, 1, 0) > 0 && (p.revents & (POLLRDHUP | POLLHUP | POLLERR))) return false;
+        return true;
+    }
+
+    int ctrl_fd_;
+    void* base_;
+    size_t total_;
+    size_t ring_bytes_;   // 연결할 때 확인한 ring 크기 (header 의 capacity 는 상대가 바꿀 수 있음)
+    std::chrono::milliseconds read_timeout_{0};
+    RingHeader* rx_;
+    RingHeader* tx_;
+    uint8_t* rx_data_;
+    uint8_t* tx_data_;
+};
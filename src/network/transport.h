@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../util/cli.h"
+#include "net_emu.h"
+#include "shm_ring.h"
+#include "wire.h"
+
+// Wire 전송 방식 선택
+//
+//   tcp  : 기존 AF_INET (host, port)
+//   unix : 같은 host 의 AF_UNIX socket (--socket-path)
+//   shm  : AF_UNIX 로 연결한 뒤 server 가 만든 shared memory ring 으로 데이터 전송
+//
+// 네 실행 파일 모두 --transport=tcp|unix|shm --socket-path=... 로 고름.
+// 위 protocol 코드는 Wire 만 보므로 전송 방식과 무관.
+//
+// --net=lan|wan|<bw>/<rtt>[/<jitter>] 를 주면 이 process 가 만드는 모든 연결의 송신에
+// network emulation 을 건다 (net_emu.h). 양쪽에 같은 profile 을 줘야 왕복이 RTT 가 됨.
+enum class Transport { tcp, unix_socket, shm };
+
+struct TransportConfig {
+    Transport   kind = Transport::tcp;
+    std::string host = "127.0.0.1";
+    int         port = 9000;
+    std::string socket_path = "/tmp/pcpsi.sock";
+    NetProfile  net;
+    std::shared_ptr<NetLink> link;   // 이 process 의 emulated uplink (연결들이 공유)
+
+    static TransportConfig from_args(const CliArgs& args, const std::string& host, int port) {
+        TransportConfig cfg;
+        cfg.host = host;
+        cfg.port = port;
+        cfg.socket_path = args.get("socket-path", cfg.socket_path);
+
+        std::string kind = args.get("transport", "tcp");
+        if      (kind == "tcp")  cfg.kind = Transport::tcp;
+        else if (kind == "unix") cfg.kind = Transport::unix_socket;
+        else if (kind == "shm")  cfg.kind = Transport::shm;
+        else throw std::invalid_argument("unknown --transport: " + kind + " (tcp|unix|shm)");
+
+        cfg.net = NetProfile::parse(args.get("net", ""));
+        if (cfg.net.enabled()) cfg.link = std::make_shared<NetLink>(cfg.net.bandwidth_bps);
+        return cfg;
+    }
+
+    std::string describe() const {
+        std::string emu = net.enabled() ? ", emulated " + net.describe() : "";
+        switch (kind) {
+        case Transport::tcp:         return host + ":" + std::to_string(port) + " (tcp" + emu + ")";
+        case Transport::unix_socket: return socket_path + " (unix" + emu + ")";
+        case Transport::shm:         return socket_path + " (shm" + emu + ")";
+        }
+        return "";
+    }
+
+    // 새 연결에 --net emulation 적용
+    std::unique_ptr<Wire> emulate(std::unique_ptr<Wire> wire) const {
+        if (net.enabled()) wire->set_net_profile(net, link);
+        return wire;
+    }
+};
+
+// ---- client ----
+inline std::unique_ptr<Wire> connect_wire(const TransportConfig& cfg) {
+    if (cfg.kind == Transport::tcp)
+        return cfg.emulate(std::make_unique<Wire>(cfg.host, cfg.port));
+
+    sockaddr_un addr{};
+    if (cfg.socket_path.size() >= sizeof(addr.sun_path))
+        throw std::invalid_argument("unix socket path too long: " + cfg.socket_path);
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, cfg.socket_path.c_str(), cfg.socket_path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket(AF_UNIX)");
+        throw std::runtime_error("socket(AF_UNIX)");
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        perror("connect(AF_UNIX)");
+        ::close(fd);
+        throw std::runtime_error("connect(AF_UNIX)");
+    }
+
+    if (cfg.kind == Transport::shm) {
+        try {
+            auto shm = ShmChannel::receive(fd);
+            return cfg.emulate(std::make_unique<Wire>(fd, std::move(shm)));
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+    }
+    return cfg.emulate(std::make_unique<Wire>(fd, Wire::adopt_fd_t{}));
+}
+
+// ---- server ----
+inline std::unique_ptr<WireListener> make_listener(const TransportConfig& cfg, int backlog) {
+    if (cfg.kind == Transport::tcp)
+        return std::make_unique<WireListener>(cfg.port, backlog);
+    return std::make_unique<WireListener>(cfg.socket_path, backlog, WireListener::unix_path_t{});
+}
+
+// 연결 하나 accept (shm 이면 ring 까지 설정)
+inline std::unique_ptr<Wire> accept_wire(WireListener& listener, const TransportConfig& cfg) {
+    auto wire = listener.accept();
+    if (cfg.kind != Transport::shm) return cfg.emulate(std::move(wire));
+
+    auto shm = ShmChannel::create_and_send(wire->fd());
+    return cfg.emulate(std::make_unique<Wire>(wire->release_fd(), std::move(shm)));
+}
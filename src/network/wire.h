@@ -3,14 +3,28 @@
 #include <cstdint>
 #include <stdexcept>
 #include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <vector>
 
 #include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 
+#include "net_emu.h"
+#include "shm_ring.h"
+#include "seal/seal.h"   // 아래 net:: helper (SEAL 객체 크기)
+
 class Wire {
     int sock_ = -1;
+    std::unique_ptr<ShmChannel> shm_;   // 있으면 데이터는 shared memory ring 으로, sock_ 은 control 용
+    std::unique_ptr<NetEmulator> emu_;  // 있으면 송신은 bandwidth/RTT emulation 을 거침 (net_emu.h)
 
     static int checked(int ret, const char* msg) {
         if (ret < 0) {
@@ -19,6 +33,66 @@ class Wire {
         }
         return ret;
     }
+
+    // ==== 작은 write 는 user-space buffer 에 모았다가 한 번에 보냄 ====
+    static constexpr size_t kCoalesceBytes = 16 * 1024;   // 이보다 작은 메시지는 buffer 에 복사
+    static constexpr size_t kFlushBytes    = 64 * 1024;   // buffer 가 이만큼 차면 flush
+    static constexpr int    kSockBufBytes  = 4 * 1024 * 1024;
+
+    std::vector<uint8_t> wbuf_;
+
+    // emulator thread 가 지연시킨 segment 를 실제로 씀 (통계는 submit 때 이미 반영)
+    void write_direct(const uint8_t* data, size_t len) {
+        if (shm_) {
+            shm_->write(data, len);
+            return;
+        }
+        while (len > 0) {
+            ssize_t r = ::send(sock_, data, len, MSG_NOSIGNAL);
+            if (r <= 0) throw std::runtime_error("send failed");
+            data += r;
+            len  -= static_cast<size_t>(r);
+        }
+    }
+
+    // iov 전체를 다 보낼 때까지 writev
+    void writev_all(iovec* iov, int iovcnt) {
+        auto t0 = clock::now();
+
+        if (emu_) {
+            for (int i = 0; i < iovcnt; ++i) {
+                emu_->submit(static_cast<const uint8_t*>(iov[i].iov_base), iov[i].iov_len);
+                bytes_sent_ += iov[i].iov_len;
+            }
+            iovcnt = 0;
+        } else if (shm_) {
+            for (int i = 0; i < iovcnt; ++i) {
+                shm_->write(static_cast<const uint8_t*>(iov[i].iov_base), iov[i].iov_len);
+                bytes_sent_ += iov[i].iov_len;
+            }
+            iovcnt = 0;
+        }
+        while (iovcnt > 0) {
+            ssize_t r = ::writev(sock_, iov, iovcnt);
+            if (r <= 0) throw std::runtime_error("send failed");
+            bytes_sent_ += static_cast<std::uint64_t>(r);
+
+            size_t left = static_cast<size_t>(r);
+            while (iovcnt > 0 && left >= iov->iov_len) {
+                left -= iov->iov_len;
+                ++iov;
+                --iovcnt;
+            }
+            if (iovcnt > 0) {
+                iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + left;
+                iov->iov_len -= left;
+            }
+        }
+
+        auto t1 = clock::now();
+        us_send_ += std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    }
+
         // ==== communication check ====
     using clock = std::chrono::high_resolution_clock;
     std::uint64_t bytes_sent_ = 0;
@@ -27,6 +101,15 @@ class Wire {
     std::uint64_t us_recv_    = 0;  // recv_raw 누적 시간 (microsec)
 
 public:
+    // Nagle 끄고 socket buffer 키움 (실패해도 치명적이지 않으므로 무시)
+    static void tune_tcp(int fd) {
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        int sz = kSockBufBytes;
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sz, sizeof(sz));
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &sz, sizeof(sz));
+    }
+
     // ==== 클라이언트용: host, port 받아서 connect ====
     Wire(const std::string& host, int port) {
         sock_ = checked(::socket(AF_INET, SOCK_STREAM, 0), "socket");
@@ -35,6 +118,7 @@ public:
         addr.sin_family = AF_INET;
         addr.sin_port   = htons(port);
         checked(::inet_pton(AF_INET, host.c_str(), &addr.sin_addr), "inet_pton");
+        tune_tcp(sock_);   // buffer 크기는 connect 전에 정해야 window scaling 에 반영됨
 
         checked(::connect(sock_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), "connect");
     }
@@ -45,6 +129,7 @@ public:
 
         int opt = 1;
         ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        tune_tcp(listen_fd);   // accept 된 socket 이 물려받음
 
         sockaddr_in addr{};
         addr.sin_family      = AF_INET;
@@ -56,21 +141,96 @@ public:
         sockaddr_in cli_addr{};
         socklen_t cli_len = sizeof(cli_addr);
         sock_ = checked(::accept(listen_fd, reinterpret_cast<sockaddr*>(&cli_addr), &cli_len), "accept");
+        tune_tcp(sock_);
 
         ::close(listen_fd);
     }
 
+    // ==== 이미 연결된 fd 사용 (socketpair 등) ====
+    struct adopt_fd_t {};
+    Wire(int fd, adopt_fd_t) : sock_(fd) {}
+
+    // ==== fd 는 control socket, 데이터는 shared memory (transport.h 참고) ====
+    Wire(int fd, std::unique_ptr<ShmChannel> shm) : sock_(fd), shm_(std::move(shm)) {}
+
+    Wire(const Wire&)            = delete;
+    Wire& operator=(const Wire&) = delete;
+
     ~Wire() {
         if (sock_ >= 0) {
+            try {
+                flush();
+            } catch (...) {
+                // 상대가 이미 끊은 경우 등은 무시
+            }
+            emu_.reset();   // 지연 중인 segment 를 다 보낸 뒤 닫음
+            shm_.reset();
             ::close(sock_);
         }
     }
 
+    int fd() const { return sock_; }
+
+    // 받는 frame (u64 길이 + payload) 의 최대 payload 크기. 길이는 상대가 정하므로 이보다 크면
+    // buffer 를 잡기 전에 거절 (daemon 하나가 frame header 하나로 OOM 이 되지 않도록).
+    // SEAL 이 허용하는 가장 큰 parameter (N = 32768, prime 64 개) 의 size-2 ciphertext /
+    // public key 가 2 * 32768 * 64 * 8 B = 32 MiB
+    static constexpr std::uint64_t kMaxFrameBytes = std::uint64_t(32) << 20;
+
+    static void check_frame_len(std::uint64_t len) {
+        if (len > kMaxFrameBytes)
+            throw std::runtime_error("frame of " + std::to_string(len) + " bytes exceeds the limit");
+    }
+
+    // fd 소유권을 넘김 (이후 이 Wire 는 닫지 않음)
+    int release_fd() {
+        flush();
+        if (emu_) {
+            emu_->drain();
+            emu_.reset();
+        }
+        int fd = sock_;
+        sock_ = -1;
+        return fd;
+    }
+
+    // 이후 recv 가 timeout 안에 데이터를 못 받으면 예외 (0 이면 무한 대기)
+    void set_recv_timeout(std::chrono::milliseconds timeout) {
+        timeval tv{};
+        tv.tv_sec  = static_cast<time_t>(timeout.count() / 1000);
+        tv.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+        ::setsockopt(sock_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if (shm_) shm_->set_read_timeout(timeout);
+    }
+
+    // fd 를 epoll 등으로 직접 읽고 써도 되는지 (shared memory 전송이나 emulation 중이면 false)
+    bool pollable() const { return !shm_ && !emu_; }
+
+    // 이후 송신에 network emulation 적용. link 는 같은 process 의 Wire 들이 공유하는 uplink
+    void set_net_profile(const NetProfile& profile, std::shared_ptr<NetLink> link) {
+        flush();
+        emu_.reset();
+        if (profile.enabled()) {
+            emu_ = std::make_unique<NetEmulator>(
+                profile, std::move(link),
+                [this](const uint8_t* data, size_t len) { write_direct(data, len); });
+        }
+    }
+
     std::uint64_t bytes_sent() const { return bytes_sent_; }
     std::uint64_t bytes_recv() const { return bytes_recv_; }
     std::uint64_t send_time_us() const { return us_send_; }
     std::uint64_t recv_time_us() const { return us_recv_; }
 
+    // 다른 경로 (AsyncWire 등) 로 이 socket 을 쓴 만큼 통계에 더함
+    void add_stats(std::uint64_t sent, std::uint64_t recvd,
+                   std::uint64_t us_send, std::uint64_t us_recv) {
+        bytes_sent_ += sent;
+        bytes_recv_ += recvd;
+        us_send_    += us_send;
+        us_recv_    += us_recv;
+    }
+
     void reset_stats() {
         bytes_sent_ = 0;
         bytes_recv_ = 0;
@@ -79,26 +239,54 @@ public:
     }
 
 
+    // head (작은 header) + body 를 하나의 메시지로 전송.
+    // 작으면 buffer 에 모으고, 크면 buffer 에 쌓인 것과 함께 writev 한 번으로 보냄.
+    void send_parts(const uint8_t* head, size_t head_len, const uint8_t* body, size_t body_len) {
+        if (head_len + body_len < kCoalesceBytes) {
+            wbuf_.insert(wbuf_.end(), head, head + head_len);
+            wbuf_.insert(wbuf_.end(), body, body + body_len);
+            if (wbuf_.size() >= kFlushBytes) flush();
+            return;
+        }
+
+        iovec iov[3];
+        int iovcnt = 0;
+        if (!wbuf_.empty()) iov[iovcnt++] = {wbuf_.data(), wbuf_.size()};
+        if (head_len > 0)   iov[iovcnt++] = {const_cast<uint8_t*>(head), head_len};
+        if (body_len > 0)   iov[iovcnt++] = {const_cast<uint8_t*>(body), body_len};
+        writev_all(iov, iovcnt);
+        wbuf_.clear();
+    }
+
     void send_raw(const uint8_t* data, size_t len) {
-        
-        auto t0 = clock::now();
+        send_parts(nullptr, 0, data, len);
+    }
 
-        size_t sent = 0;
-        while (sent < len) {
-            ssize_t r = ::send(sock_, data + sent, len - sent, 0);
-            if (r <= 0) throw std::runtime_error("send failed");
-            sent += static_cast<size_t>(r);
-            bytes_sent_ += static_cast<std::uint64_t>(r);
-        }
-        
-        auto t1 = clock::now();
-        us_send_ += std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    // u64 길이 + payload (psi_wire.h 의 send_bytes 형식)
+    void send_frame(const uint8_t* data, size_t len) {
+        std::uint64_t n = len;
+        send_parts(reinterpret_cast<const uint8_t*>(&n), sizeof(n), data, len);
+    }
+
+    // buffer 에 남은 것을 모두 전송
+    void flush() {
+        if (wbuf_.empty()) return;
+        iovec iov{wbuf_.data(), wbuf_.size()};
+        writev_all(&iov, 1);
+        wbuf_.clear();
     }
 
     void recv_raw(uint8_t* data, size_t len) {
+        // 상대가 우리 메시지를 기다리고 있을 수 있으므로 받기 전에 항상 flush
+        flush();
 
         auto t0 = clock::now();
 
+        if (shm_) {
+            shm_->read(data, len);
+            bytes_recv_ += len;
+            len = 0;
+        }
         size_t recvd = 0;
         while (recvd < len) {
             ssize_t r = ::recv(sock_, data + recvd, len - recvd, 0);
@@ -115,6 +303,82 @@ public:
 
 };
 
+// ==== 여러 client 를 받는 서버용 listen socket (daemon 모드) ====
+class WireListener {
+    int listen_fd_ = -1;
+    std::string unix_path_;   // AF_UNIX 이면 소멸 시 unlink
+
+public:
+    // AF_UNIX listen socket (같은 host 전용)
+    struct unix_path_t {};
+    WireListener(const std::string& path, int backlog, unix_path_t) : unix_path_(path) {
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path))
+            throw std::invalid_argument("unix socket path too long: " + path);
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+        listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd_ < 0) {
+            perror("socket(AF_UNIX)");
+            throw std::runtime_error("socket(AF_UNIX)");
+        }
+        ::unlink(path.c_str());   // 이전 실행이 남긴 socket 파일
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            ::listen(listen_fd_, backlog) < 0) {
+            perror("bind/listen(AF_UNIX)");
+            ::close(listen_fd_);
+            throw std::runtime_error("bind/listen(AF_UNIX)");
+        }
+    }
+
+    WireListener(int port, int backlog) {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd_ < 0) {
+            perror("socket(listen)");
+            throw std::runtime_error("socket(listen)");
+        }
+
+        int opt = 1;
+        ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        Wire::tune_tcp(listen_fd_);
+
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = INADDR_ANY;
+        addr.sin_port        = htons(port);
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            ::listen(listen_fd_, backlog) < 0) {
+            perror("bind/listen");
+            ::close(listen_fd_);
+            throw std::runtime_error("bind/listen");
+        }
+    }
+
+    WireListener(const WireListener&)            = delete;
+    WireListener& operator=(const WireListener&) = delete;
+
+    ~WireListener() {
+        if (listen_fd_ >= 0) ::close(listen_fd_);
+        if (!unix_path_.empty()) ::unlink(unix_path_.c_str());
+    }
+
+    // 다음 client 연결을 기다림 (EINTR 등은 재시도)
+    std::unique_ptr<Wire> accept() {
+        for (;;) {
+            int fd = ::accept(listen_fd_, nullptr, nullptr);
+            if (fd >= 0) {
+                Wire::tune_tcp(fd);
+                return std::make_unique<Wire>(fd, Wire::adopt_fd_t{});
+            }
+            if (errno != EINTR && errno != ECONNABORTED) {
+                perror("accept");
+                throw std::runtime_error("accept");
+            }
+        }
+    }
+};
+
 
 
 // #pragma once
@@ -0,0 +1,592 @@
+#include "psi_client.h"
+
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "../hashing/cuckoo.h"
+#include "../hashing/p_cuckoo.h"
+#include "../network/psi_wire.h"
+#include "../network/wire.h"
+#include "../protocol/intersection.h"
+#include "../protocol/labels.h"
+#include "../protocol/result_stream.h"
+#include "../seal_util/batching.h"
+#include "../seal_util/key_store.h"
+#include "../seal_util/parallel_decrypt.h"
+#include "../seal_util/psi_parms.h"
+#include "../util/phase_timer.h"
+#include "../util/trace.h"
+#include "seal/seal.h"
+
+class PsiClient::Impl {
+public:
+    virtual ~Impl() = default;
+
+    virtual void connect(const TransportConfig& transport) = 0;
+    virtual PsiQueryResult query(const std::vector<uint32_t>& set) = 0;
+    virtual void close() = 0;
+    virtual bool connected() const = 0;
+
+    PsiParams     params;
+    PsiSetupInfo  setup;
+    PhaseRegistry phases{"client"};
+};
+
+namespace {
+
+template <class Packing>
+class PsiClientImpl final : public PsiClient::Impl {
+public:
+    PsiClientImpl(const PsiParams& p, const PsiClientOptions& opts)
+        : opts_(opts),
+          parms_(make_psi_parms<Packing>(p.log_poly_mod)),
+          context_(parms_)
+    {
+        params = p;
+        std::cout << "Plainmodulus: " << parms_.plain_modulus().value() << std::endl;
+
+        // key generation (key_file 이 있으면 저장된 key 를 재사용)
+        if (!opts_.key_file.empty() && load_client_keys(opts_.key_file, context_, secret_key_, public_key_)) {
+            std::cout << "Loaded keys from " << opts_.key_file << "\n";
+        } else {
+            seal::KeyGenerator keygen(context_);
+            secret_key_ = keygen.secret_key();
+            keygen.create_public_key(public_key_);
+            if (!opts_.key_file.empty()) save_client_keys(opts_.key_file, secret_key_, public_key_);
+        }
+
+        encryptor_.emplace(context_, public_key_);
+        batch_encoder_.emplace(context_);
+        parallel_decryptor_.emplace(context_, secret_key_, opts_.num_threads);
+        slot_count_ = batch_encoder_->slot_count();
+        if (!opts_.phase_log.empty()) phase_sink_ = std::make_unique<PhaseSink>(opts_.phase_log);
+
+        // server 는 fingerprint 로 cache 를 찾으므로 한 번만 직렬화
+        parms_buf_ = serialize_seal_obj(parms_);
+        pk_buf_    = serialize_seal_obj(public_key_);
+    }
+
+    ~PsiClientImpl() override {
+        try {
+            close();
+        } catch (const std::exception&) {
+            // 상대가 먼저 끊은 경우: 정리만
+        }
+    }
+
+    void connect(const TransportConfig& transport) override {
+        close();
+        phases.clear();
+
+        // session clock 의 0 = connect 시작 (server 에는 setup 때 기준점과의 차이를 보냄)
+        connect_start_ = TraceRecorder::clock::now();
+        if (!opts_.trace_file.empty()) {
+            trace_ = std::make_unique<TraceRecorder>("client", 2);
+            trace_->set_origin(connect_start_);
+            trace_->name_thread("client");
+        }
+        phases.set_trace(trace_.get());
+        parallel_decryptor_->set_trace(trace_.get());
+
+        PhaseScope connect_scope(phases, "connect");
+        transport_ = transport;
+        wire_ = connect_wire(transport_);   // 클라이언트 모드로 connect
+        send_u64(*wire_, kHelloSession);
+        std::cout << "Connected to " << transport_.describe() << "\n";
+
+        // server 가 이미 가진 key material 은 다시 보내지 않음: fingerprint 를 먼저 보내고
+        // 답 (kHaveContext | kHavePublicKey) 은 첫 hash 협상 응답 앞에서 받음
+        send_parms_id(*wire_, parms_.parms_id());
+        send_u64(*wire_, fingerprint_bytes(pk_buf_));
+
+        setup = PsiSetupInfo{};
+        setup_done_  = false;
+        num_queries_ = 0;
+        table_.reset();
+        current_set_.clear();
+    }
+
+    bool connected() const override { return wire_ != nullptr; }
+
+    void close() override {
+        if (!wire_) return;
+        auto wire = std::move(wire_);
+        stripe_wires_.clear();
+        stripes_.clear();
+        if (setup_done_) send_u64(*wire, kQueryEnd);   // session 종료
+        wire->flush();
+
+        // 연결 하나 = phase record 하나
+        if (phase_sink_ && setup_done_) {
+            phases.meta().add("packing", params.packing == PsiPacking::packing_2d ? "2d" : "1d")
+                         .add("log_poly_mod", params.log_poly_mod)
+                         .add("r", Packing::r).add("d", Packing::d).add("slot_count", slot_count_)
+                         .add("segments", setup.num_segments).add("hash_count", chosen_indices_.size())
+                         .add("queries", num_queries_)
+                         .add("threads", parallel_decryptor_->num_threads())
+                         .add("stripes", setup.num_stripes).add("pinned", setup.pinned)
+                         .add("context_hit", setup.context_hit).add("key_hit", setup.key_hit)
+                         .add("transport", transport_.describe());
+            phase_sink_->write(phases);
+        }
+        if (trace_) {
+            std::string path = numbered_trace_path(opts_.trace_file, ++traced_connections_);
+            trace_->write(path);
+            std::cout << "[client] trace written to " << path << " (" << trace_->size() << " spans)\n";
+            phases.set_trace(nullptr);
+            parallel_decryptor_->set_trace(nullptr);
+            trace_.reset();
+        }
+    }
+
+    PsiQueryResult query(const std::vector<uint32_t>& set) override {
+        if (!wire_) throw std::runtime_error("PsiClient::query before connect");
+        Wire& wire = *wire_;
+        PsiQueryResult res;
+
+        // 연결의 첫 query 는 setup phase 를 먼저 (cuckoo table 도 여기서 만듦)
+        if (!setup_done_) res.us_hash = run_setup(set);
+        PhaseScope query_scope(phases, "query", static_cast<long long>(++num_queries_));
+
+        // 다른 set 이면 cuckoo table 을 다시 만듦 (bins 는 그대로).
+        // 지금 hash 조합으로 안 되면 server 가 준 hash 20개 중에서 다시 골라 kQueryRehash 로 알림
+        if (set != current_set_) res.us_hash = rebuild_table(set, res.rehashed);
+        PermCuckooTable& p_cuckoo_table = *table_;
+        size_t num_hash     = chosen_indices_.size();
+        size_t num_segments = setup.num_segments;
+
+        // --- 교집합 검사기: hash/segment 별 occupancy bitmap (client only) ---
+        IntersectionChecker<Packing> checker(p_cuckoo_table, num_hash, slot_count_);
+        const LabelLayout<Packing> layout(setup.label_bits);
+        const size_t stride = layout.cts_per_row();   // 결과 row 하나당 ciphertext 개수
+
+        std::vector<uint64_t> cuckoo_bins_all(bins_);
+
+        // p_cuckoo_table.get_table() == vector<optional<TableEntry>>
+        const auto& cuckoo_table_all = p_cuckoo_table.get_table();
+
+        for (size_t i = 0; i < bins_; ++i) {
+            if (cuckoo_table_all[i].has_value()) {
+                // x_R 을 d 개 lane 에 복제
+                cuckoo_bins_all[i] = Packing::replicate(cuckoo_table_all[i]->x_r);
+            } else {
+                cuckoo_bins_all[i] = 0; // dummy
+            }
+        }
+
+        // encryption (client, segment 마다 ciphertext 하나)
+        std::optional<PhaseScope> enc_scope;
+        enc_scope.emplace(phases, "encrypt");
+        std::vector<seal::Ciphertext> query_cts = batch_encrypt_cuckoo_bins_segments(
+            cuckoo_bins_all, *encryptor_, *batch_encoder_
+        );
+        // labeled mode: label 을 이 bin 의 (hash, x_R) 에 묶는 key ciphertext (protocol/labels.h)
+        std::vector<seal::Ciphertext> key_cts;
+        if (layout.labeled())
+            key_cts = batch_encrypt_cuckoo_bins_segments(label_keys<Packing>(p_cuckoo_table), *encryptor_, *batch_encoder_);
+        res.us_enc = enc_scope->stop().wall_us;
+        enc_scope.reset();
+
+        // send query (online phase 의 byte 는 이 query 만: reset 뒤에 scope 시작)
+        wire.reset_stats();
+        std::optional<PhaseScope> online_scope;
+        online_scope.emplace(phases, "online", wire);
+        {
+            PhaseScope send_scope(phases, "send_query");
+            if (res.rehashed) {
+                send_u64(wire, kQueryRehash);
+                send_hash_params(wire, chosen_hashes_);
+            } else {
+                send_u64(wire, kQueryNext);
+            }
+            for (const auto& ct : query_cts) {
+                send_seal_obj(wire, ct);
+            }
+            for (const auto& ct : key_cts) {
+                send_seal_obj(wire, ct);
+            }
+        }
+
+        std::vector<std::vector<uint64_t>>& slot_bufs = slot_bufs_;   // 복호 결과 buffer (재사용)
+
+        // 결과 수신: 연결 하나면 (socket) AsyncWire 로 복호/검사 중에도 계속 읽고,
+        // striping 이면 stripe 마다 thread 로 받아서 sequence number 순서로 재조립
+        ResultReceiver receiver(wire, stripes_, num_hash * num_segments, trace_.get());
+        std::vector<seal::Ciphertext> compare_results;
+        std::vector<seal::Ciphertext> row_results, label_cts;   // labeled mode
+        std::vector<typename IntersectionChecker<Packing>::Hit> hits, label_hits;
+        std::vector<size_t> label_base;   // label_hits[k] 의 chunk 0 이 label_cts 에서 몇 번째인지
+
+        for (size_t h = 0; h < num_hash; ++h) {
+            for (size_t seg = 0; seg < num_segments; ++seg) {
+                // ---- 서버로부터 결과 수신 (hash h, segment seg) ----
+                {
+                    PhaseScope recv_scope(phases, "receive");
+                    std::uint64_t num_ct = receiver.next_count();   // 이 hash/segment 에 대한 ciphertext 개수
+                    receiver.receive(num_ct, compare_results, context_);
+                }
+
+                // labeled mode: row 마다 [결과, label ct ...] 이므로 결과 ciphertext 만 먼저 복호
+                std::vector<seal::Ciphertext>* results = &compare_results;
+                if (layout.labeled()) {
+                    if (compare_results.size() % stride != 0)
+                        throw std::runtime_error("labeled result count is not a multiple of the row stride");
+                    row_results.resize(compare_results.size() / stride);
+                    for (size_t i = 0; i < row_results.size(); ++i)
+                        row_results[i] = std::move(compare_results[i * stride]);
+                    results = &row_results;
+                }
+
+                // ---- 복호 + decode (thread 별 Decryptor/BatchEncoder) ----
+                {
+                    PhaseScope dec_scope(phases, "decrypt");
+                    parallel_decryptor_->decrypt_decode(*results, slot_bufs);
+                    res.us_dec += dec_scope.stop().wall_us;
+                }
+
+                // ---- 검사 ----
+                {
+                    PhaseScope check_scope(phases, "check");
+                    for (size_t i = 0; i < results->size(); ++i) {
+                        hits.clear();
+                        checker.check(h, seg, slot_bufs[i], layout.labeled() ? &hits : nullptr);
+                        // match 된 (row, lane) 의 label ciphertext 만 모음 (같은 lane 의 hit 끼리는 공유)
+                        size_t lane_base[Packing::d];
+                        for (auto& b : lane_base) b = SIZE_MAX;
+                        for (const auto& hit : hits) {
+                            if (lane_base[hit.lane] == SIZE_MAX) {
+                                lane_base[hit.lane] = label_cts.size();
+                                for (size_t c = 0; c < layout.chunks(); ++c)
+                                    label_cts.push_back(std::move(compare_results[i * stride + layout.label_offset(hit.lane, c)]));
+                            }
+                            label_hits.push_back(hit);
+                            label_base.push_back(lane_base[hit.lane]);
+                        }
+                    }
+                    res.us_check += check_scope.stop().wall_us;
+                }
+
+                // ---- label 복호: match 된 slot 에 label chunk 가 그대로 남아 있음 ----
+                if (!label_cts.empty()) {
+                    {
+                        PhaseScope dec_scope(phases, "decrypt_labels");
+                        parallel_decryptor_->decrypt_decode(label_cts, label_slot_bufs_);
+                        res.us_dec += dec_scope.stop().wall_us;
+                    }
+                    for (size_t k = 0; k < label_hits.size(); ++k) {
+                        uint64_t label = 0;
+                        for (size_t c = 0; c < layout.chunks(); ++c)
+                            layout.add_chunk(label, c, label_slot_bufs_[label_base[k] + c][label_hits[k].slot]);
+                        checker.set_label(label_hits[k].result, label);
+                    }
+                    label_cts.clear();
+                }
+                label_hits.clear();
+                label_base.clear();
+            }
+
+            std::cout << "[client] hash " << h
+                    << " Intersection count: " << checker.count(h) << std::endl;
+            res.hash_counts.push_back(checker.count(h));
+        }
+        receiver.finish();   // stripe 별 통신 통계를 wire 에 반영
+
+        // 교집합 원소 (정렬)
+        {
+            PhaseScope check_scope(phases, "check");
+            res.intersection = checker.sorted_result();
+            if (layout.labeled()) {
+                res.labels = checker.labels();
+                res.labels.resize(res.intersection.size(), 0);
+            }
+            res.us_check += check_scope.stop().wall_us;
+        }
+
+        res.us_online = online_scope->stop().wall_us;
+        online_scope.reset();
+
+        // online 통신 통계 (query 하나, reset 이후 ~ 끝까지)
+        res.bytes_sent = wire.bytes_sent();
+        res.bytes_recv = wire.bytes_recv();
+        res.us_send    = wire.send_time_us();
+        res.us_recv    = wire.recv_time_us();
+        return res;
+    }
+
+private:
+    // 연결의 첫 query: segment / hash 협상 후 parms, pk, chosen_hashes, stripe 요청 전송.
+    // cuckoo table 만드는 데 쓴 시간 (us) 을 리턴
+    long long run_setup(const std::vector<uint32_t>& set) {
+        Wire& wire = *wire_;
+        std::optional<PhaseScope> setup_scope;
+        setup_scope.emplace(phases, "setup", wire);
+        const size_t hash_count = params.hash_count;
+        const size_t threshold  = params.threshold;
+        const size_t r          = Packing::r;   // 22 - log_bins
+        const auto&  load_factor_thr = params.load_factor_thr;
+
+        // client set 이 ciphertext 하나의 slot 수보다 크면 cuckoo table 을
+        // slot_count 단위 segment 여러 개로 나눔 (segment 마다 query ciphertext 하나)
+        size_t num_segments = num_query_segments(
+            set.size(), slot_count_, load_factor_thr[hash_count]);
+
+        std::uint64_t server_has = 0;
+        bool server_has_known = false;
+        TraceRecorder::clock::time_point sync_point;
+        bool found = false;
+        size_t used_hash_count = 0;
+        long long us_gen_cuc = 0;
+
+        // segment 개수 협상: 서버가 같은 bins 로 hash 를 만들도록 segment 개수를 보내고,
+        // 이 bins 로 cuckoo 가 실패하면 segment 를 두 배로 늘려서 다시 요청.
+        // 0 을 보내면 segment 확정.
+        while (!found) {
+            if (num_segments > kMaxQuerySegments) {
+                throw std::runtime_error(
+                    "Adaptive PermCuckoo failed: no valid k* up to max query segments");
+            }
+            bins_ = num_segments * slot_count_;
+            send_u64(wire, static_cast<std::uint64_t>(num_segments));
+            std::cout << "Query segments: " << num_segments
+                    << " (bins = " << bins_ << ")\n";
+
+            if (!server_has_known) {
+                // 답을 기다린 구간의 중간 = server 가 답을 보낸 순간 (session clock 기준점)
+                wire.flush();
+                auto t_send = TraceRecorder::clock::now();
+                server_has = recv_u64(wire);
+                auto t_recv = TraceRecorder::clock::now();
+                setup.label_bits = static_cast<size_t>(recv_u64(wire));   // 0: unlabeled
+                if (setup.label_bits > 64) throw std::runtime_error("invalid label bits from server");
+                sync_point = t_send + (t_recv - t_send) / 2;
+                server_has_known = true;
+            }
+
+            // ------------- 서버에서 all_hashes 받기 ----------------
+            all_hashes_ = recv_hash_params(wire);
+            std::cout << "Received " << all_hashes_.size()
+                    << " hash functions from server.\n";
+
+            // server 가 table 을 미리 인코딩해 둔 (pinned) 조합. 없으면 0 개
+            pinned_indices_.assign(static_cast<size_t>(recv_u64(wire)), 0);
+            for (auto& idx : pinned_indices_) {
+                idx = static_cast<size_t>(recv_u64(wire));
+                if (idx >= all_hashes_.size()) throw std::runtime_error("invalid pinned hash index from server");
+            }
+
+            // ------------- Adaptive selection + permutation-based cuckoo -------------
+            double load_factor = static_cast<double>(set.size())
+                            / static_cast<double>(bins_);
+
+            PhaseScope cuckoo_scope(phases, "cuckoo");
+
+            // pinned 조합을 먼저 시도: 성공하면 server 는 online 에 table 을 만들지 않음
+            if (!pinned_indices_.empty()) {
+                auto pinned_result = build_successful_p_cuckoo_table(
+                    bins_, threshold, r, {pinned_indices_}, all_hashes_, set);
+                if (pinned_result.has_value()) {
+                    table_.emplace(std::move(pinned_result->table));
+                    chosen_indices_ = pinned_indices_;
+                    used_hash_count = pinned_indices_.size();
+                    setup.pinned    = true;
+                    found = true;
+                    std::cout << "Using the server-pinned hash combination\n";
+                } else {
+                    std::cout << "Server-pinned hashes failed for this set, choosing hashes instead\n";
+                }
+            }
+
+            for (size_t k_star = 1; k_star <= hash_count && !found; ++k_star)
+            {
+                double Lk = load_factor_thr[k_star];
+
+                // if |X|/B > L_k* then continue
+                if (load_factor > Lk) {
+                    continue;
+                }
+
+                // 이 k_star 에 대해 가능한 hash 조합 생성
+                auto combs_k = params.hash_combinations(all_hashes_.size(), k_star);
+
+                // Permcuckoo(X, {H_1, ..., H_{k*}}, k*)
+                auto build_result_opt = build_successful_p_cuckoo_table(
+                    bins_, threshold, r, combs_k, all_hashes_, set);
+
+                // 이 k_star 에선 실패 → 다음 k_star 로
+                if (!build_result_opt.has_value()) {
+                    continue;
+                }
+
+                // 여기까지 왔으면 성공한 조합을 찾았다는 뜻
+                auto& build_result = *build_result_opt;
+                table_.emplace(std::move(build_result.table));
+                chosen_indices_ = std::move(build_result.chosen_indices);
+                used_hash_count = k_star;
+                found = true;
+                break;
+            }
+
+            us_gen_cuc += cuckoo_scope.stop().wall_us;
+
+            if (!found) {
+                num_segments <<= 1;
+            }
+        }
+        send_u64(wire, 0);   // segment 확정
+
+        std::cout << "Cuckoo table generated in " << us_gen_cuc << " us\n";
+        std::cout << "Used hash count k* = " << used_hash_count << "\n";
+        std::cout << "Chosen hash indices: ";
+        for (auto idx : chosen_indices_) std::cout << idx << " ";
+        std::cout << std::endl;
+
+        // 1) chosen_hashes 추출
+        chosen_hashes_.clear();
+        for (auto idx : chosen_indices_)
+            chosen_hashes_.push_back(all_hashes_[idx]);
+
+        // 2) 서버에 setup 정보 전송 (server cache 에 없는 것만)
+        if (!(server_has & kHaveContext))   send_bytes(wire, parms_buf_);
+        if (!(server_has & kHavePublicKey)) send_bytes(wire, pk_buf_);
+        send_hash_params(wire, chosen_hashes_);
+        send_u64(wire, static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(sync_point - connect_start_).count()));
+        std::cout << "Server cache: context " << ((server_has & kHaveContext) ? "hit" : "miss")
+                  << ", public key " << ((server_has & kHavePublicKey) ? "hit" : "miss") << "\n";
+
+        // 3) 결과를 여러 연결로 나눠 받을지 (striping). server 가 허용하면 token 으로 추가 연결
+        send_u64(wire, opts_.num_stripes);
+        if (std::uint64_t token = recv_u64(wire)) {
+            PhaseScope stripes_scope(phases, "stripes");
+            std::uint64_t n_extra = recv_u64(wire);
+            for (std::uint64_t i = 1; i <= n_extra; ++i) {
+                auto w = connect_wire(transport_);
+                send_u64(*w, kHelloStripe);
+                send_u64(*w, token);
+                send_u64(*w, i);
+                w->flush();
+                stripe_wires_.push_back(std::move(w));
+            }
+            std::cout << "Receiving results over " << (n_extra + 1) << " connections\n";
+        }
+        for (auto& w : stripe_wires_) stripes_.push_back(w.get());   // 연결 동안 모든 query 가 재사용
+
+        // 여기까지의 통신은 모두 preprocessing 단계 (연결당 한 번)
+        setup.num_segments = num_segments;
+        setup.hash_indices = chosen_indices_;
+        setup.context_hit  = (server_has & kHaveContext) != 0;
+        setup.key_hit      = (server_has & kHavePublicKey) != 0;
+        setup.num_stripes  = stripes_.size() + 1;
+        setup.bytes_sent   = wire.bytes_sent();
+        setup.bytes_recv   = wire.bytes_recv();
+        setup.us_send      = wire.send_time_us();
+        setup.us_recv      = wire.recv_time_us();
+        setup.us_hash      = us_gen_cuc;
+        setup.us_setup     = setup_scope->stop().wall_us;
+        setup_scope.reset();
+
+        current_set_ = set;
+        setup_done_  = true;
+        return us_gen_cuc;
+    }
+
+    // 같은 연결의 다른 set: bins 는 그대로 두고 table 만 다시 만듦 (필요하면 조합 변경)
+    long long rebuild_table(const std::vector<uint32_t>& set, bool& rehash) {
+        const size_t threshold = params.threshold;
+        const size_t r         = Packing::r;
+
+        PhaseScope cuckoo_scope(phases, "cuckoo");
+        auto rebuilt = build_successful_p_cuckoo_table(
+            bins_, threshold, r, {chosen_indices_}, all_hashes_, set);
+        if (!rebuilt.has_value() && !pinned_indices_.empty() && pinned_indices_ != chosen_indices_) {
+            rebuilt = build_successful_p_cuckoo_table(
+                bins_, threshold, r, {pinned_indices_}, all_hashes_, set);
+            rehash = rebuilt.has_value();
+        }
+        double load_factor = static_cast<double>(set.size()) / static_cast<double>(bins_);
+        for (size_t k_star = 1; k_star <= params.hash_count && !rebuilt.has_value(); ++k_star) {
+            if (load_factor > params.load_factor_thr[k_star]) continue;
+            rebuilt = build_successful_p_cuckoo_table(
+                bins_, threshold, r, params.hash_combinations(all_hashes_.size(), k_star), all_hashes_, set);
+            rehash = rebuilt.has_value();
+        }
+        if (!rebuilt.has_value()) {
+            throw std::runtime_error(
+                "query set does not fit the session's query segments; start a new session");
+        }
+        table_.emplace(std::move(rebuilt->table));
+        if (rehash) {
+            chosen_indices_ = std::move(rebuilt->chosen_indices);
+            chosen_hashes_.clear();
+            for (auto idx : chosen_indices_) chosen_hashes_.push_back(all_hashes_[idx]);
+            std::cout << "Switching to hash indices: ";
+            for (auto idx : chosen_indices_) std::cout << idx << " ";
+            std::cout << std::endl;
+        }
+        current_set_ = set;
+        return cuckoo_scope.stop().wall_us;
+    }
+
+    PsiClientOptions opts_;
+
+    // ---- 객체 수명 동안 유지 (warm state) ----
+    seal::EncryptionParameters parms_;
+    seal::SEALContext          context_;
+    seal::SecretKey            secret_key_;
+    seal::PublicKey            public_key_;
+    std::optional<seal::Encryptor>    encryptor_;
+    std::optional<seal::BatchEncoder> batch_encoder_;
+    std::optional<ParallelDecryptor>  parallel_decryptor_;
+    size_t slot_count_ = 0;
+    std::vector<uint8_t> parms_buf_;
+    std::vector<uint8_t> pk_buf_;
+    std::vector<std::vector<uint64_t>> slot_bufs_;
+    std::vector<std::vector<uint64_t>> label_slot_bufs_;   // labeled mode: label ciphertext 복호 buffer
+    std::unique_ptr<PhaseSink> phase_sink_;
+    size_t traced_connections_ = 0;
+
+    // ---- 연결 하나 동안 유지 ----
+    TransportConfig transport_;
+    std::unique_ptr<Wire> wire_;
+    TraceRecorder::clock::time_point connect_start_;
+    std::unique_ptr<TraceRecorder> trace_;
+    std::vector<std::unique_ptr<Wire>> stripe_wires_;
+    std::vector<Wire*> stripes_;
+    bool setup_done_ = false;
+    size_t num_queries_ = 0;
+    size_t bins_ = 0;
+    std::vector<HashParams> all_hashes_;
+    std::vector<HashParams> chosen_hashes_;
+    std::vector<size_t> chosen_indices_;
+    std::vector<size_t> pinned_indices_;
+    std::optional<PermCuckooTable> table_;
+    std::vector<uint32_t> current_set_;
+};
+
+} // namespace
+
+PsiClient::PsiClient(const PsiParams& params, const PsiClientOptions& opts) {
+    params.validate();
+    if (params.packing == PsiPacking::packing_2d) impl_ = std::make_unique<PsiClientImpl<Packing2D>>(params, opts);
+    else                                          impl_ = std::make_unique<PsiClientImpl<Packing1D>>(params, opts);
+}
+
+PsiClient::~PsiClient() = default;
+
+void PsiClient::connect(const TransportConfig& transport) { impl_->connect(transport); }
+
+PsiQueryResult PsiClient::query(const std::vector<uint32_t>& set) { return impl_->query(set); }
+
+void PsiClient::close() { impl_->close(); }
+
+bool PsiClient::connected() const { return impl_->connected(); }
+
+const PsiParams& PsiClient::params() const { return impl_->params; }
+
+const PsiSetupInfo& PsiClient::setup_info() const { return impl_->setup; }
+
+const PhaseRegistry& PsiClient::phases() const { return impl_->phases; }
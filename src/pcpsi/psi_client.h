@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../network/transport.h"
+#include "psi_params.h"
+
+class PhaseRegistry;   // util/phase_timer.h
+
+// libpcpsi client
+//
+// SEALContext, key, encryptor / decryptor 는 생성자에서 한 번 만들고 객체가 살아있는 동안
+// 유지한다 (연결을 다시 맺어도 그대로). 연결 하나에서의 setup (segment / hash 협상,
+// parms/pk 전송, stripe) 은 그 연결의 첫 query 때 한 번만 하고, 이후 query 는 online 만.
+//
+//   PsiClient client(PsiParams::packing_2d(), opts);
+//   client.connect(transport);
+//   auto res = client.query(set_a);   // setup + query
+//   res      = client.query(set_b);   // query (필요하면 hash 조합만 바꿈)
+//   client.close();
+struct PsiClientOptions {
+    size_t      num_threads = 0;   // 복호 thread 수 (0: 코어 수)
+    size_t      num_stripes = 1;   // 결과 수신용 연결 수
+    std::string key_file;          // 있으면 key 를 저장/재사용 (server 의 public key cache hit)
+    std::string phase_log;         // 있으면 연결이 끝날 때 phase timing JSON 한 줄을 append
+    std::string trace_file;        // 있으면 연결마다 Chrome trace (두 번째 연결부터 a.2.json, ...)
+};
+
+struct PsiQueryResult {
+    std::vector<uint32_t> intersection;    // 정렬됨
+    std::vector<uint64_t> labels;          // labeled server 면 intersection[i] 의 label (아니면 비어 있음)
+    std::vector<size_t>   hash_counts;     // hash 별 교집합 개수
+    bool rehashed = false;                 // 이 query 에서 hash 조합을 바꿨는지
+
+    // latency (us). us_hash 는 cuckoo table 을 다시 만든 경우만 (같은 set 이면 0)
+    long long us_hash   = 0;
+    long long us_enc    = 0;
+    long long us_dec    = 0;
+    long long us_check  = 0;
+    long long us_online = 0;   // query 전송 ~ 검사 끝 wall time
+
+    // online 통신 (이 query)
+    std::uint64_t bytes_sent = 0;
+    std::uint64_t bytes_recv = 0;
+    std::uint64_t us_send    = 0;
+    std::uint64_t us_recv    = 0;
+};
+
+// 연결당 한 번 하는 setup 의 결과와 통신량
+struct PsiSetupInfo {
+    size_t num_segments = 0;
+    std::vector<size_t> hash_indices;   // 처음 고른 조합 (server 가 준 hash 20개 중 index)
+    bool pinned      = false;           // server-pinned 조합을 썼는지
+    bool context_hit = false;           // server cache 에 parms 가 있었는지
+    bool key_hit     = false;           // server cache 에 public key 가 있었는지
+    size_t label_bits = 0;              // server 가 labeled mode 면 label bit 수 (0: unlabeled)
+    size_t num_stripes = 1;
+    long long us_setup = 0;             // 첫 query 의 setup (segment 협상 ~ stripe 연결) wall time
+    long long us_hash  = 0;             // 그 중 cuckoo table 만든 시간
+
+    std::uint64_t bytes_sent = 0;
+    std::uint64_t bytes_recv = 0;
+    std::uint64_t us_send    = 0;
+    std::uint64_t us_recv    = 0;
+};
+
+class PsiClient {
+public:
+    explicit PsiClient(const PsiParams& params, const PsiClientOptions& opts = {});
+    ~PsiClient();   // 연결 중이면 close()
+
+    PsiClient(const PsiClient&)            = delete;
+    PsiClient& operator=(const PsiClient&) = delete;
+
+    // 연결 중이면 먼저 close()
+    void connect(const TransportConfig& transport);
+
+    // 첫 query 의 set 크기로 segment 개수가 정해지므로 이후 set 도 그 bins 에 들어가야 함
+    // (안 들어가면 runtime_error, 새 연결로 다시)
+    PsiQueryResult query(const std::vector<uint32_t>& set);
+
+    void close();
+    bool connected() const;
+
+    const PsiParams&    params() const;
+    const PsiSetupInfo& setup_info() const;   // 현재 (마지막) 연결의 setup
+    // 현재 (마지막) 연결의 phase 별 wall/cpu 시간과 byte 수 (connect, setup, query[i]/...)
+    const PhaseRegistry& phases() const;
+
+    class Impl;   // psi_client.cpp (Packing 별 구현의 base)
+
+private:
+    std::unique_ptr<Impl> impl_;
+};
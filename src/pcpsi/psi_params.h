@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../hashing/cuckoo.h"
+#include "../seal_util/slot_packing.h"
+
+// libpcpsi 공통 parameter
+//
+// packing 과 log_poly_mod 는 짝이 정해져 있다 (Packing::r = 22 - log_poly_mod).
+//   packing_2d : log_poly_mod 14, Packing2D   (psi_client / psi_server)
+//   packing_1d : log_poly_mod 12, Packing1D   (psi_client_1d / psi_server_1d)
+// client 와 server 가 같은 값을 써야 함 (BFV parms 는 seal_util/psi_parms.h 로 만듦).
+//
+// threshold / load_factor_thr 는 client 의 k* 선택 (와 segment 개수) 을 정한다. 기본값 대신
+// psi_cuckoo_calibrate (bench/cuckoo_calibrate.cpp) 가 측정해서 쓴 파일을 load_cuckoo_thresholds 로 읽을 수 있음.
+enum class PsiPacking { packing_2d, packing_1d };
+
+struct PsiParams {
+    PsiPacking packing      = PsiPacking::packing_2d;
+    int        log_poly_mod = 14;
+    size_t     threshold    = 3000;   // cuckoo eviction 한도
+    size_t     hash_count   = 3;      // client 가 쓰는 최대 hash 개수 (k)
+    // 각 k(=1,2,3)에 대한 load factor threshold L_k (index 0 은 사용 안 함).
+    // psi_cuckoo_calibrate --tries=1 --target=0.01 (threshold 3000, 1/4/16 segment) 측정값:
+    //   L_1 0.001 (2D), L_2 0.18 (2D) / 0.44 (1D), L_3 0.91 (2D) / 0.9 (1D) -> packing 공통으로 작은 값
+    std::array<double, 4> load_factor_thr = {0.0, 0.001, 0.18, 0.9};
+    // k* 마다 시도하는 hash 조합 개수 상한 (get_combinations 순서로 앞에서부터).
+    // 조합을 다 돌면 (k = 3 이면 1140 개) 안 들어가는 set 하나에 수십 초가 걸리고,
+    // L_k 아래의 set 은 보통 첫 조합에 들어가므로 그 뒤는 segment 를 늘리는 편이 빠름
+    size_t max_hash_combinations = 16;
+
+    static PsiParams packing_2d() { return PsiParams{}; }
+
+    static PsiParams packing_1d() {
+        PsiParams p;
+        p.packing      = PsiPacking::packing_1d;
+        p.log_poly_mod = 12;
+        return p;
+    }
+
+    size_t slot_count() const { return size_t(1) << log_poly_mod; }
+
+    // k 개 hash 의 조합 중 client 가 시도하는 것 (max_hash_combinations 개까지)
+    std::vector<std::vector<size_t>> hash_combinations(size_t num_hashes, size_t k) const {
+        auto combs = get_combinations(num_hashes, k);
+        if (combs.size() > max_hash_combinations) combs.resize(max_hash_combinations);
+        return combs;
+    }
+
+    // calibration 파일 (한 줄에 하나, '#' 뒤는 주석):
+    //   threshold <relocation 한도>
+    //   k <k> <L_k>
+    // 파일에 없는 값은 그대로 둠
+    void load_cuckoo_thresholds(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) throw std::runtime_error("cannot open cuckoo threshold file: " + path);
+        std::string line;
+        size_t line_no = 0;
+        while (std::getline(in, line)) {
+            ++line_no;
+            line = line.substr(0, line.find('#'));
+            std::istringstream is(line);
+            std::string key;
+            if (!(is >> key)) continue;
+            auto bad = [&] {
+                return std::invalid_argument(path + ":" + std::to_string(line_no) + ": invalid line: " + line);
+            };
+            if (key == "threshold") {
+                size_t t = 0;
+                if (!(is >> t) || t == 0) throw bad();
+                threshold = t;
+            } else if (key == "k") {
+                size_t k = 0;
+                double lk = 0;
+                if (!(is >> k >> lk) || k < 1 || k >= load_factor_thr.size() || lk < 0 || lk > 1) throw bad();
+                load_factor_thr[k] = lk;
+            } else {
+                throw bad();
+            }
+        }
+    }
+
+    void validate() const {
+        unsigned r = packing == PsiPacking::packing_2d ? Packing2D::r : Packing1D::r;
+        if (log_poly_mod < 0 || static_cast<unsigned>(log_poly_mod) + r != 22)
+            throw std::invalid_argument("log_poly_mod " + std::to_string(log_poly_mod) +
+                                        " does not match the packing (r = " + std::to_string(r) + ")");
+        if (max_hash_combinations == 0)
+            throw std::invalid_argument("max_hash_combinations must be positive");
+        if (hash_count < 1 || hash_count >= load_factor_thr.size())
+            throw std::invalid_argument("hash_count must be 1.." + std::to_string(load_factor_thr.size() - 1));
+        // segment 개수를 L_{hash_count} 로 정하므로 0 이면 끝나지 않음
+        if (load_factor_thr[hash_count] <= 0)
+            throw std::invalid_argument("load factor threshold of k = " + std::to_string(hash_count) + " must be positive");
+    }
+};
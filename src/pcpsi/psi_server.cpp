@@ -0,0 +1,202 @@
+#include "psi_server.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include "../hashing/cuckoo.h"
+#include "../network/session_pool.h"
+#include "../protocol/context_cache.h"
+#include "../protocol/labels.h"
+#include "../protocol/pinned_tables.h"
+#include "../protocol/result_stream.h"
+#include "../protocol/server_session.h"
+#include "../protocol/shard.h"
+#include "../protocol/table_cache.h"
+#include "../seal_util/psi_parms.h"
+#include "../util/phase_timer.h"
+#include "../util/trace.h"
+
+// session 함수는 Packing 마다 한 번씩만 instantiate 되고, 나머지는 packing 과 무관
+struct PsiServer::Impl {
+    using SessionFn = void (*)(Wire&, const ServerSessionConfig&, ServerTableCache*, ShardPool*);
+
+    PsiParams           params;
+    PsiServerOptions    opts;
+    SessionFn           session = nullptr;
+    ServerContextCache  contexts;
+    PinnedHashes        pinned;
+    ServerLabels        labels;   // labeled mode
+    std::unique_ptr<PhaseSink> phase_sink;
+    ServerSessionConfig session_cfg;
+    std::unique_ptr<ServerTableCache> tables;   // 비샤딩 모드
+    std::unique_ptr<ShardPool>        shards;   // 샤딩 모드
+    bool shards_used = false;                   // shard worker 는 session 하나만 처리
+    std::atomic<size_t> traced_sessions{0};
+
+    template <class Packing>
+    void setup(std::vector<uint32_t> server_elems) {
+        session = &serve_psi_session<Packing>;
+        const size_t slot_count     = params.slot_count();
+        const size_t pipeline_depth = opts.pipeline_depth;
+        const size_t mask_pool      = opts.mask_pool;
+
+        session_cfg = ServerSessionConfig();
+        session_cfg.slot_count     = slot_count;
+        session_cfg.pipeline_depth = pipeline_depth;
+        session_cfg.max_stripes = opts.max_stripes;
+        session_cfg.stream_window = opts.stream_window;
+        session_cfg.mask_pool     = mask_pool;
+        session_cfg.contexts    = &contexts;
+        if (!labels.labels.empty()) session_cfg.labels = &labels;
+        if (!opts.phase_log.empty()) {
+            phase_sink = std::make_unique<PhaseSink>(opts.phase_log);
+            session_cfg.phase_sink = phase_sink.get();
+        }
+
+        // ------------------ sharded mode: worker process fork ------------------
+        // server set 을 num_shards 개로 나눠 worker 가 table/encoding/평가를 맡음.
+        // client socket 을 물려주지 않도록 accept 전 (여기) 에 fork.
+        if (opts.num_shards > 1) {
+            shards = std::make_unique<ShardPool>(
+                server_elems, opts.num_shards,
+                [slot_count, pipeline_depth, mask_pool](Wire& coord, const std::vector<uint32_t>& shard, size_t idx) {
+                    run_shard_worker<Packing>(coord, shard, idx, slot_count, pipeline_depth, mask_pool);
+                });
+            std::cout << "Spawned " << shards->size() << " shard workers\n";
+            return;
+        }
+
+        // 비샤딩 모드: server set 과 simple table 을 cache 에 한 벌만 두고 session 끼리 공유
+        tables = std::make_unique<ServerTableCache>(std::move(server_elems), Packing::r);
+
+        // 해당 segment 개수의 hash 20개 table 을 미리 만듦
+        for (size_t num_segments : opts.precompute_segments) {
+            auto start_pre = std::chrono::high_resolution_clock::now();
+            size_t bins = num_segments * slot_count;
+            tables->get_all(bins, generate_fixed_hash_functions(bins, 20));
+            auto end_pre = std::chrono::high_resolution_clock::now();
+            std::cout << "Precomputed tables for " << num_segments << " segment(s) in "
+                    << std::chrono::duration_cast<std::chrono::milliseconds>(
+                           end_pre - start_pre).count() << " ms\n";
+        }
+
+        // segment 개수마다 hash 조합을 하나 정하고 table + encoding 을 미리 함.
+        // client 가 그 조합으로 cuckoo 에 성공하면 online 에는 평가만 남음 (안 되면 client 가 직접 고름)
+        if (!opts.pinned_segments.empty()) {
+            auto crypto = contexts.get(make_psi_parms<Packing>(params.log_poly_mod));
+            for (size_t num_segments : opts.pinned_segments) {
+                auto start_pin = std::chrono::high_resolution_clock::now();
+                const auto& pin = pinned.precompute<Packing>(
+                    num_segments, slot_count, params.threshold, opts.pinned_load, *tables, *crypto);
+                auto end_pin = std::chrono::high_resolution_clock::now();
+                std::cout << "Pinned hash indices for " << num_segments << " segment(s): ";
+                for (auto idx : pin.indices) std::cout << idx << " ";
+                std::cout << "(tables encoded in "
+                        << std::chrono::duration_cast<std::chrono::milliseconds>(
+                               end_pin - start_pin).count() << " ms)\n";
+            }
+            session_cfg.pinned = &pinned;
+        }
+    }
+
+    void run(Wire& wire, const ServerSessionConfig& cfg) {
+        if (shards) {
+            if (shards_used) throw std::runtime_error("shard workers already served their session");
+            shards_used = true;
+        }
+        if (opts.trace_file.empty()) {
+            session(wire, cfg, tables.get(), shards.get());
+            return;
+        }
+        ServerSessionConfig traced = cfg;
+        traced.trace_path = numbered_trace_path(opts.trace_file, ++traced_sessions);
+        session(wire, traced, tables.get(), shards.get());
+    }
+};
+
+PsiServer::PsiServer(const PsiParams& params, std::vector<uint32_t> server_elems, const PsiServerOptions& opts)
+    : impl_(std::make_unique<Impl>())
+{
+    params.validate();
+    if (!opts.pinned_segments.empty() && opts.num_shards > 1) {
+        // shard worker 는 각자 table 을 만들므로 coordinator 가 미리 인코딩할 수 없음
+        throw std::invalid_argument("pinned segments cannot be combined with shards");
+    }
+    if (opts.stream_window > 0 && opts.num_shards > 1) {
+        // shard worker 는 자기 session 설정으로 미리 encode 함
+        throw std::invalid_argument("stream window cannot be combined with shards");
+    }
+    if (!opts.labels.empty() && opts.num_shards > 1) {
+        // label row 는 session 이 table 과 같이 encode 함 (shard worker 는 label 을 모름)
+        throw std::invalid_argument("labels cannot be combined with shards");
+    }
+    if (!opts.labels.empty() && opts.stream_window > 0) {
+        // label row 는 session 이 전부 미리 encode 하므로 window 만큼만 들고 있지 못함
+        throw std::invalid_argument("labels cannot be combined with a stream window");
+    }
+    impl_->params = params;
+    impl_->opts   = opts;
+    impl_->labels = ServerLabels{std::move(impl_->opts.labels), opts.label_bits};   // 한 벌만
+    impl_->labels.validate();
+    if (params.packing == PsiPacking::packing_2d) impl_->setup<Packing2D>(std::move(server_elems));
+    else                                          impl_->setup<Packing1D>(std::move(server_elems));
+}
+
+PsiServer::~PsiServer() = default;
+
+void PsiServer::serve(Wire& wire, StripeAcceptor accept_stripes) {
+    ServerSessionConfig cfg = impl_->session_cfg;
+    cfg.accept_stripes = std::move(accept_stripes);
+    impl_->run(wire, cfg);
+}
+
+void PsiServer::serve_one(const TransportConfig& transport) {
+    // 1. 클라이언트 연결을 기다리는 Wire (서버 모드)
+    std::cout << "Server listening on " << transport.describe() << "...\n";
+    auto listener = make_listener(transport, 16);
+    serve_one(*listener, transport);
+}
+
+void PsiServer::serve_one(WireListener& listener, const TransportConfig& transport) {
+    StripeRegistry no_stripes_yet;   // token 을 주기 전이므로 stripe 연결은 오지 않음
+    auto wire = accept_session(listener, transport, no_stripes_yet);   // accept 한번
+    std::cout << "Client connected.\n";
+    serve(*wire, [&](std::uint64_t token, size_t n) {
+        return accept_stripes(listener, transport, token, n);
+    });
+}
+
+void PsiServer::serve_forever(const TransportConfig& transport, size_t num_workers) {
+    if (impl_->shards) {
+        // shard worker 는 session 하나만 처리하고 끝나므로 daemon 과 같이 못 씀
+        throw std::invalid_argument("daemon mode cannot be combined with shards");
+    }
+
+    // accept loop 가 연결의 hello 를 보고 새 session 은 pool 로, stripe 연결은 registry 로
+    auto listener = make_listener(transport, 128);
+    StripeRegistry stripes;
+    ServerSessionConfig cfg = impl_->session_cfg;
+    cfg.expect_stripes = [&stripes](std::uint64_t token, size_t n) {
+        stripes.expect(token, n, kStripeTimeout);
+    };
+    cfg.accept_stripes = [&stripes](std::uint64_t token, size_t n) {
+        return stripes.wait(token, n, kStripeTimeout);
+    };
+    SessionPool pool(num_workers, 2 * num_workers,
+        [&](Wire& wire, std::uint64_t id) {
+            std::cout << "[session " << id << "] started\n";
+            impl_->run(wire, cfg);
+            std::cout << "[session " << id << "] done (" << cached_tables()
+                    << " cached tables)\n";
+        });
+    std::cout << "Server daemon listening on " << transport.describe()
+            << " with " << pool.num_workers() << " workers...\n";
+    ::serve_forever([&] { return accept_session(*listener, transport, stripes); }, pool);
+}
+
+const PsiParams& PsiServer::params() const { return impl_->params; }
+
+size_t PsiServer::cached_tables() const { return impl_->tables ? impl_->tables->size() : 0; }
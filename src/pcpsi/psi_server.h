@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../network/transport.h"
+#include "../network/wire.h"
+#include "psi_params.h"
+
+// libpcpsi server
+//
+// server set, simple table cache, SEAL context / public key cache, pinned table 을
+// 객체가 살아있는 동안 유지한다. 서비스에 넣어 두면 session 마다 process 를 띄우거나
+// table 을 다시 만들 필요가 없음 (protocol 은 protocol/server_session.h 그대로).
+//
+//   PsiServer server(PsiParams::packing_2d(), read_uint32_file(path), opts);
+//   server.serve_forever(transport, 8);        // daemon
+//   server.serve_one(transport);               // 연결 하나만
+//   server.serve(wire);                        // 직접 accept 한 연결 (hello 는 읽은 뒤)
+struct PsiServerOptions {
+    size_t pipeline_depth = 8;    // 0: 동기 전송
+    size_t max_stripes    = 16;
+    size_t num_shards     = 1;    // > 1 이면 생성자에서 worker process 를 fork (serve_one 전용)
+    std::vector<size_t> precompute_segments;   // 이 segment 개수들의 table 을 생성자에서 만듦
+    std::vector<size_t> pinned_segments;       // server-pinned hash 조합 (protocol/pinned_tables.h)
+    double pinned_load    = 0.2;
+    size_t stream_window  = 0;    // > 0 이면 row 를 query 마다 이 개수만큼씩 encode (protocol/row_stream.h)
+    size_t mask_pool      = 32;   // session (shard) 마다 미리 만들어 두는 mask 개수 (protocol/mask_pool.h)
+    // 비어 있지 않으면 labeled mode: 교집합 원소의 label 을 같은 응답으로 보냄 (protocol/labels.h).
+    // 없는 원소는 label 0
+    std::unordered_map<uint32_t, uint64_t> labels;
+    size_t label_bits     = 32;
+    std::string phase_log;   // 있으면 session 마다 phase timing JSON 한 줄을 append (util/phase_timer.h)
+    std::string trace_file;  // 있으면 session 마다 Chrome trace (두 번째 session 부터 a.2.json, ...)
+};
+
+class PsiServer {
+public:
+    using StripeAcceptor = std::function<std::vector<std::unique_ptr<Wire>>(std::uint64_t token, size_t n)>;
+
+    PsiServer(const PsiParams& params, std::vector<uint32_t> server_elems, const PsiServerOptions& opts = {});
+    ~PsiServer();
+
+    PsiServer(const PsiServer&)            = delete;
+    PsiServer& operator=(const PsiServer&) = delete;
+
+    // hello (kHelloSession) 까지 읽은 연결로 session 하나. accept_stripes 가 없으면 striping 안 함.
+    // 여러 thread 에서 동시에 불러도 됨 (sharded 면 안 됨)
+    void serve(Wire& wire, StripeAcceptor accept_stripes = nullptr);
+
+    // listen 해서 session 하나를 받아 처리
+    void serve_one(const TransportConfig& transport);
+    // 이미 listen 중인 listener 에서 session 하나 (client 가 먼저 connect 해도 됨)
+    void serve_one(WireListener& listener, const TransportConfig& transport);
+
+    // accept loop + worker pool (리턴하지 않음)
+    [[noreturn]] void serve_forever(const TransportConfig& transport, size_t num_workers);
+
+    const PsiParams& params() const;
+    size_t cached_tables() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
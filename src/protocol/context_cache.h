@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "seal/seal.h"
+
+// session 마다 client 가 보내는 parms 로 만드는 SEAL 객체 묶음
+//
+// SEALContext 생성 (NTT table, modulus precomputation) 은 log_poly_mod=14 에서 session 당
+// 고정 비용이 크므로 ServerContextCache 에 두고 같은 parms 의 session 들이 공유한다.
+// BatchEncoder / Evaluator 는 const 로만 쓰므로 여러 session thread 가 동시에 써도 됨.
+struct ServerCrypto {
+    seal::EncryptionParameters parms;
+    seal::SEALContext          context;
+    seal::BatchEncoder         batch_encoder;
+    seal::Evaluator            evaluator;
+
+    explicit ServerCrypto(const seal::EncryptionParameters& p)
+        : parms(p), context(parms), batch_encoder(context), evaluator(context) {}
+};
+
+// parms_id -> ServerCrypto, (parms_id, key fingerprint) -> PublicKey
+//
+// client 는 setup 때 fingerprint 만 먼저 보내고, server 가 없다고 답한 것만 전체를 보낸다.
+// context 는 ServerTableCache 처럼 처음 요청한 session 이 한 번만 만들고 나머지는 기다림.
+// key 는 client 마다 다르므로 개수 제한 (오래된 것부터 버림). context 도 parms 가 client 마음대로라
+// kMaxContexts 개까지만 (오래 안 쓴 것부터 버림, 쓰고 있는 session 은 shared_ptr 로 계속 유지).
+// parms 가 packing 에 맞는지는 session 이 get() 전에 확인함 (server_session.h).
+class ServerContextCache {
+public:
+    using CryptoPtr = std::shared_ptr<const ServerCrypto>;
+    using KeyPtr    = std::shared_ptr<const seal::PublicKey>;
+
+    static constexpr size_t kMaxKeys     = 1024;
+    static constexpr size_t kMaxContexts = 8;
+
+    ServerContextCache() = default;
+    ServerContextCache(const ServerContextCache&)            = delete;
+    ServerContextCache& operator=(const ServerContextCache&) = delete;
+
+    // 이미 만들어졌거나 만드는 중이면 리턴 (만드는 중이면 기다림), 없으면 nullptr
+    CryptoPtr find(const seal::parms_id_type& id) {
+        std::shared_future<CryptoPtr> fut;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = contexts_.find(id);
+            if (it == contexts_.end()) return nullptr;
+            touch_context(id);
+            fut = it->second;
+        }
+        try {
+            return fut.get();
+        } catch (...) {
+            return nullptr;   // 다른 session 의 build 실패는 miss 로
+        }
+    }
+
+    CryptoPtr get(const seal::EncryptionParameters& parms) {
+        auto id = parms.parms_id();
+
+        std::promise<CryptoPtr> promise;
+        std::shared_future<CryptoPtr> fut;
+        bool build = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = contexts_.find(id);
+            if (it == contexts_.end()) {
+                fut = promise.get_future().share();
+                contexts_.emplace(id, fut);
+                context_order_.push_back(id);
+                if (context_order_.size() > kMaxContexts) {
+                    contexts_.erase(context_order_.front());
+                    context_order_.pop_front();
+                }
+                build = true;
+            } else {
+                touch_context(id);
+                fut = it->second;
+            }
+        }
+
+        if (build) {
+            try {
+                promise.set_value(std::make_shared<const ServerCrypto>(parms));
+            } catch (...) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (contexts_.erase(id))
+                        context_order_.erase(std::find(context_order_.begin(), context_order_.end(), id));
+                }
+                promise.set_exception(std::current_exception());
+            }
+        }
+        return fut.get();
+    }
+
+    KeyPtr find_key(const seal::parms_id_type& id, std::uint64_t key_fp) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = keys_.find({id, key_fp});
+        return it == keys_.end() ? nullptr : it->second;
+    }
+
+    void put_key(const seal::parms_id_type& id, std::uint64_t key_fp, KeyPtr key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        KeyId kid{id, key_fp};
+        if (!keys_.emplace(kid, std::move(key)).second) return;
+        key_order_.push_back(kid);
+        if (key_order_.size() > kMaxKeys) {
+            keys_.erase(key_order_.front());
+            key_order_.pop_front();
+        }
+    }
+
+private:
+    using KeyId = std::pair<seal::parms_id_type, std::uint64_t>;
+
+    // 최근에 쓴 context 를 맨 뒤로 (mutex_ 잡고, kMaxContexts 개라 선형 탐색)
+    void touch_context(const seal::parms_id_type& id) {
+        auto it = std::find(context_order_.begin(), context_order_.end(), id);
+        if (it != context_order_.end()) context_order_.erase(it);
+        context_order_.push_back(id);
+    }
+
+    std::mutex mutex_;
+    std::map<seal::parms_id_type, std::shared_future<CryptoPtr>> contexts_;
+    std::deque<seal::parms_id_type> context_order_;   // 오래 안 쓴 것이 앞
+    std::map<KeyId, KeyPtr> keys_;
+    std::deque<KeyId> key_order_;
+};
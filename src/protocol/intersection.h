@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "../hashing/p_cuckoo.h"
+
+// Client 교집합 검사
+//
+// (hash, segment) 마다 실제 client 원소가 있는 slot index 목록(occupancy)을 미리 만들고,
+// 복호된 slot 중 그 index 만 읽어서 d 개 lane 을 shift/mask 로 한 번에 검사한다.
+//   - % R, / R 대신 lane & (2^r - 1) (R 은 2의 거듭제곱)
+//   - branch 없이 match 된 index 를 모아둔 뒤 (AVX2 가 있으면 gather 로 4 slot 씩)
+//   - match 된 bin 마다 PermCuckooTable::recover_element 로 원래 원소를 복원.
+//
+// server set 에는 중복이 없으므로 bin 하나는 최대 한 번 match 된다.
+//
+// labeled mode 에서는 check() 에 hits 를 넘겨 match 된 slot / lane 과 결과 index 를 받고,
+// 그 (row, lane) 의 label ciphertext 를 복호한 뒤 set_label 로 붙인다.
+template <class Packing>
+class IntersectionChecker {
+public:
+    struct Hit {
+        uint32_t slot;     // segment 안 slot index
+        unsigned lane;     // match 된 lane (server bin 안 원소 위치 = row * d + lane)
+        size_t   result;   // result_ index (set_label 용)
+    };
+
+    IntersectionChecker(
+        const PermCuckooTable& table,
+        size_t num_hash,
+        size_t slot_count)
+        : table_(table),
+          slot_count_(slot_count),
+          counts_(num_hash, 0)
+    {
+        const auto& entries = table.get_table();
+        num_segments_ = (entries.size() + slot_count - 1) / slot_count;
+        occupancy_.assign(num_hash, std::vector<std::vector<uint32_t>>(num_segments_));
+
+        for (size_t bin = 0; bin < entries.size(); ++bin) {
+            if (!entries[bin].has_value()) continue;
+            occupancy_[entries[bin]->hash_idx][bin / slot_count].push_back(
+                static_cast<uint32_t>(bin % slot_count));
+        }
+    }
+
+    // (hash h, segment seg) 결과 ciphertext 하나의 decode 된 slot 검사
+    // hits 가 있으면 match 마다 Hit 를 append
+    void check(size_t h, size_t seg, const std::vector<uint64_t>& slots, std::vector<Hit>* hits = nullptr) {
+        const auto& ids = occupancy_[h][seg];
+        hits_.resize(ids.size());
+
+        size_t n_hits = collect_hits(slots.data(), ids.data(), ids.size(), hits_.data());
+
+        size_t base = seg * slot_count_;
+        for (size_t k = 0; k < n_hits; ++k) {
+            if (hits) hits->push_back(Hit{hits_[k], matched_lane(slots[hits_[k]]), result_.size()});
+            result_.push_back(table_.recover_element(base + hits_[k]));
+        }
+        counts_[h] += n_hits;
+    }
+
+    // labeled mode: result index 의 label (없는 원소는 0)
+    void set_label(size_t result, uint64_t label) {
+        if (labels_.size() < result_.size()) labels_.resize(result_.size(), 0);
+        labels_[result] = label;
+    }
+
+    // 누적된 결과만 비움 (occupancy 는 table 이 같으면 그대로 재사용)
+    void reset() {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        result_.clear();
+        labels_.clear();
+    }
+
+    size_t count(size_t h) const { return counts_[h]; }
+    size_t total_count() const { return result_.size(); }
+
+    // 교집합 원소 (정렬). label 이 있으면 같이 정렬 (labels()[i] 가 sorted_result()[i] 의 label)
+    const std::vector<uint32_t>& sorted_result() {
+        if (labels_.empty()) {
+            std::sort(result_.begin(), result_.end());
+            return result_;
+        }
+        labels_.resize(result_.size(), 0);
+        std::vector<size_t> order(result_.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return result_[a] < result_[b]; });
+        std::vector<uint32_t> result(order.size());
+        std::vector<uint64_t> labels(order.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            result[i] = result_[order[i]];
+            labels[i] = labels_[order[i]];
+        }
+        result_.swap(result);
+        labels_.swap(labels);
+        return result_;
+    }
+    const std::vector<uint64_t>& labels() const { return labels_; }
+
+private:
+    // match 된 slot 에서 0 이 아닌 2^r 의 배수인 첫 lane
+    static unsigned matched_lane(uint64_t v) {
+        for (unsigned j = 0; j < Packing::d; ++j) {
+            uint64_t lane = (v >> (j * Packing::lane_bits)) & Packing::lane_mask;
+            if (lane != 0 && (lane & (Packing::r_val - 1)) == 0) return j;
+        }
+        return 0;
+    }
+
+    // d 개 lane 중 하나라도 0 이 아닌 2^r 의 배수이면 1
+    static uint32_t any_lane_match(uint64_t v) {
+        uint32_t m = 0;
+        for (unsigned j = 0; j < Packing::d; ++j) {
+            uint64_t lane = (v >> (j * Packing::lane_bits)) & Packing::lane_mask;
+            m |= static_cast<uint32_t>((lane != 0) & ((lane & (Packing::r_val - 1)) == 0));
+        }
+        return m;
+    }
+
+    // slots[ids[k]] 중 match 된 ids[k] 를 out 에 모으고 개수 리턴 (branch 없는 compaction)
+    static size_t collect_hits(
+        const uint64_t* slots, const uint32_t* ids, size_t n, uint32_t* out)
+    {
+        size_t n_hits = 0;
+        size_t k = 0;
+#if defined(__AVX2__)
+        const __m256i lane_mask = _mm256_set1_epi64x(static_cast<long long>(Packing::lane_mask));
+        const __m256i low_mask  = _mm256_set1_epi64x(static_cast<long long>(Packing::r_val - 1));
+        const __m256i zero      = _mm256_setzero_si256();
+        for (; k + 4 <= n; k += 4) {
+            __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ids + k));
+            __m256i v   = _mm256_i32gather_epi64(
+                reinterpret_cast<const long long*>(slots), idx, 8);
+            __m256i m = zero;
+            for (unsigned j = 0; j < Packing::d; ++j) {
+                __m256i lane = _mm256_and_si256(
+                    _mm256_srli_epi64(v, static_cast<int>(j * Packing::lane_bits)), lane_mask);
+                __m256i is_zero  = _mm256_cmpeq_epi64(lane, zero);
+                __m256i low_zero = _mm256_cmpeq_epi64(_mm256_and_si256(lane, low_mask), zero);
+                m = _mm256_or_si256(m, _mm256_andnot_si256(is_zero, low_zero));
+            }
+            unsigned bits = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(m)));
+            // 대부분 miss 이므로 4개 모두 miss 인 경우만 빠르게 넘김
+            if (bits == 0) continue;
+            for (unsigned b = 0; b < 4; ++b) {
+                out[n_hits] = ids[k + b];
+                n_hits += (bits >> b) & 1u;
+            }
+        }
+#endif
+        for (; k < n; ++k) {
+            out[n_hits] = ids[k];
+            n_hits += any_lane_match(slots[ids[k]]);
+        }
+        return n_hits;
+    }
+
+    const PermCuckooTable& table_;
+    size_t slot_count_;
+    size_t num_segments_ = 0;
+    std::vector<std::vector<std::vector<uint32_t>>> occupancy_;   // [h][seg] -> slot index
+    std::vector<size_t> counts_;
+    std::vector<uint32_t> hits_;     // scratch
+    std::vector<uint32_t> result_;
+    std::vector<uint64_t> labels_;   // labeled mode: result_ 와 같은 index
+};
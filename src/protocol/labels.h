@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../hashing/p_cuckoo.h"
+#include "../hashing/simple.h"
+#include "../util/trace.h"
+#include "mask_pool.h"
+#include "server_eval.h"
+#include "seal/seal.h"
+
+// Labeled mode: 교집합 원소마다 server 가 가진 label 을 같은 응답에 실어 보냄
+//
+// 결과 row 하나 (bin 마다 원소 d 개) 뒤에 lane j, chunk c 마다 label ciphertext 를 하나씩 붙인다.
+//   label ct[j][c] = (key - probe(y_j)) * u + label_c(y_j)     (u: [1, t) 균등 mask, 매번 새로)
+// key 는 client 가 query ciphertext 뒤에 segment 마다 하나씩 더 보내는 ciphertext 로
+//   key slot   = h << r | x_R   (h: client 가 그 bin 에 쓴 hash 의 index, 빈 bin 은 empty_key)
+//   probe slot = h << r | y_R   (h: 이 table 의 hash index, 빈 lane 은 empty_probe)
+// bin 과 hash 가 같고 x_R == y_R 이면 x == y 이므로 교집합 원소의 slot 에서만 key - probe 가 0 이
+// 되어 label chunk 가 그대로 남고, 나머지 slot 은 균등 난수.
+// (query = replicate(x_R) 와 비교하면 같은 bin 에 다른 hash 로 들어간 같은 x_R 의 server 원소와,
+//  dummy 0 인 빈 bin 에서 y_R == 0 인 원소의 label 이 풀린다. 그래서 key 를 따로 보냄)
+// empty_key / empty_probe 는 2^(plain_bits - 1) 이상이라 어떤 h << r | x_R 와도 다르고 서로도 다름.
+// chunk 는 plain_bits - 1 bit 씩 (plain modulus 보다 작음).
+//
+// (hash, segment) 칸의 ciphertext 순서는 row 마다
+//   [결과, lane 0 chunk 0 .. chunk C-1, lane 1 chunk 0 .., ...]
+// client 는 결과 ciphertext 로 match 된 (row, lane) 을 찾은 뒤 그 label ciphertext 만 복호한다.
+
+// server 의 원소 -> label (없는 원소는 label 0)
+struct ServerLabels {
+    std::unordered_map<uint32_t, uint64_t> labels;
+    size_t label_bits = 32;
+
+    void validate() const {
+        if (label_bits == 0 || label_bits > 64)
+            throw std::invalid_argument("label_bits must be in [1, 64]");
+        if (label_bits == 64) return;
+        for (const auto& [x, label] : labels)
+            if (label >> label_bits)
+                throw std::invalid_argument("label of element " + std::to_string(x) + " does not fit in "
+                                            + std::to_string(label_bits) + " bits");
+    }
+};
+
+template <class Packing>
+class LabelLayout {
+public:
+    static constexpr unsigned chunk_bits = Packing::plain_bits - 1;
+    // plain modulus 는 plain_bits bit 소수 (> 2^(plain_bits - 1) + 1) 이므로 둘 다 slot 에 들어감
+    static constexpr uint64_t empty_key   = uint64_t(1) << (Packing::plain_bits - 1);
+    static constexpr uint64_t empty_probe = empty_key + 1;
+
+    // client 의 key 와 server 의 probe 가 같은 식 (hash index, x_R)
+    static uint64_t key(size_t hash_idx, uint32_t x_r) {
+        const uint64_t k = (static_cast<uint64_t>(hash_idx) << Packing::r) | x_r;
+        if (k >= empty_key) throw std::invalid_argument("hash index too large for a label key");
+        return k;
+    }
+
+    explicit LabelLayout(size_t label_bits) : label_bits_(label_bits) {
+        if (label_bits_ > 64) throw std::invalid_argument("label_bits must be at most 64");
+    }
+
+    bool   labeled() const { return label_bits_ > 0; }
+    size_t label_bits() const { return label_bits_; }
+    size_t chunks() const { return (label_bits_ + chunk_bits - 1) / chunk_bits; }
+    // 결과 row 하나당 ciphertext 개수 (unlabeled 면 1)
+    size_t cts_per_row() const { return 1 + Packing::d * chunks(); }
+    // row 안에서 (lane, chunk) label ciphertext 의 위치
+    size_t label_offset(size_t lane, size_t chunk) const { return 1 + lane * chunks() + chunk; }
+
+    uint64_t chunk(uint64_t label, size_t c) const {
+        const unsigned shift = static_cast<unsigned>(c * chunk_bits);
+        return shift >= 64 ? 0 : (label >> shift) & ((uint64_t(1) << chunk_bits) - 1);
+    }
+    void add_chunk(uint64_t& label, size_t c, uint64_t value) const {
+        const unsigned shift = static_cast<unsigned>(c * chunk_bits);
+        if (shift < 64) label |= value << shift;
+    }
+
+private:
+    size_t label_bits_;
+};
+
+// client: cuckoo bin 마다 label key (TableEntry::hash_idx 는 chosen_hashes 순서 = server 의 h)
+template <class Packing>
+std::vector<uint64_t> label_keys(const PermCuckooTable& table) {
+    const auto& entries = table.get_table();
+    std::vector<uint64_t> keys(entries.size(), LabelLayout<Packing>::empty_key);
+    for (size_t i = 0; i < entries.size(); ++i)
+        if (entries[i].has_value()) keys[i] = LabelLayout<Packing>::key(entries[i]->hash_idx, entries[i]->x_r);
+    return keys;
+}
+
+// 결과 row 하나에 붙는 plaintext: lane 별 probe 와 (lane, chunk) 별 label
+struct LabelRow {
+    std::vector<seal::Plaintext> probes;   // [lane]
+    std::vector<seal::Plaintext> chunks;   // [lane * chunks + chunk]
+};
+// [h][seg][row] (server_plaintexts 와 같은 row 개수)
+using ServerLabelRows = std::vector<std::vector<std::vector<LabelRow>>>;
+
+// table 하나 (chosen_hashes 의 hash_idx 번째) 의 label row. bin 마다 (row, lane) 원소를 한 번 읽어
+// probe / chunk slot 을 같이 채움 (slot_rows 는 1 + chunks 개 buffer 로 재사용)
+template <class Packing>
+std::vector<std::vector<LabelRow>> encode_label_table(
+    const PermSimpleHashTable& table,
+    size_t hash_idx,
+    const ServerLabels& labels,
+    const LabelLayout<Packing>& layout,
+    size_t slot_count,
+    const seal::BatchEncoder& batch_encoder,
+    SlotRows& slot_rows,
+    TraceRecorder* trace = nullptr)
+{
+    const RowEncoder<Packing> rows(table, slot_count);
+    const auto& bins  = table.get_table();
+    const size_t n_ch = layout.chunks();
+    if (slot_rows.size() < 1 + n_ch) slot_rows.resize(1 + n_ch);
+    for (size_t k = 0; k < 1 + n_ch; ++k) slot_rows[k].resize(slot_count);
+
+    std::vector<std::vector<LabelRow>> out(rows.num_segments());
+    for (size_t seg = 0; seg < rows.num_segments(); ++seg) {
+        TraceSpan span(trace, "encode.labels", "encode");
+        if (span.enabled()) span.set_args(JsonObject().add("seg", seg).add("rows", rows.rows(seg)));
+
+        out[seg].resize(rows.rows(seg));
+        const size_t first = seg * slot_count;
+        for (size_t row = 0; row < rows.rows(seg); ++row) {
+            LabelRow& lr = out[seg][row];
+            lr.probes.resize(Packing::d);
+            lr.chunks.resize(Packing::d * n_ch);
+            for (size_t lane = 0; lane < Packing::d; ++lane) {
+                const size_t j = row * Packing::d + lane;
+                for (size_t i = 0; i < slot_count; ++i) {
+                    const auto& bin = bins[first + i];
+                    uint64_t probe = layout.empty_probe;
+                    uint64_t label = 0;
+                    if (j < bin.size()) {
+                        const uint32_t y = bin[j];
+                        probe = layout.key(hash_idx, y);
+                        auto it = labels.labels.find(table.recover_element(first + i, y));
+                        if (it != labels.labels.end()) label = it->second;
+                    }
+                    slot_rows[0][i] = probe;
+                    for (size_t c = 0; c < n_ch; ++c) slot_rows[1 + c][i] = layout.chunk(label, c);
+                }
+                batch_encoder.encode(slot_rows[0], lr.probes[lane]);
+                for (size_t c = 0; c < n_ch; ++c)
+                    batch_encoder.encode(slot_rows[1 + c], lr.chunks[lane * n_ch + c]);
+            }
+        }
+    }
+    return out;
+}
+
+template <class Packing>
+ServerLabelRows encode_label_tables(
+    const std::vector<std::shared_ptr<const PermSimpleHashTable>>& server_tables,
+    const ServerLabels& labels,
+    const LabelLayout<Packing>& layout,
+    size_t slot_count,
+    const seal::BatchEncoder& batch_encoder,
+    TraceRecorder* trace = nullptr)
+{
+    ServerLabelRows label_rows;
+    label_rows.reserve(server_tables.size());
+    SlotRows slot_rows;
+    for (size_t h = 0; h < server_tables.size(); ++h)
+        label_rows.push_back(encode_label_table<Packing>(
+            *server_tables[h], h, labels, layout, slot_count, batch_encoder, slot_rows, trace));
+    return label_rows;
+}
+
+// 결과 row 하나의 label ciphertext d * chunks 개를 순서대로 push(ct). key_ct 는 같은 segment 의 key
+template <class Packing, class Push>
+void evaluate_label_row(
+    const seal::Evaluator& evaluator,
+    const seal::Ciphertext& key_ct,
+    const LabelRow& row,
+    const LabelLayout<Packing>& layout,
+    MaskPool<Packing>& masks,   // MaskKind::uniform
+    Push&& push)
+{
+    seal::Ciphertext diff, out;
+    for (size_t lane = 0; lane < Packing::d; ++lane) {
+        evaluator.sub_plain(key_ct, row.probes[lane], diff);
+        evaluator.transform_to_ntt_inplace(diff);   // chunk 마다 mask 만 다르므로 NTT 는 한 번
+        for (size_t c = 0; c < layout.chunks(); ++c) {
+            evaluator.multiply_plain(diff, masks.take(), out);
+            evaluator.transform_from_ntt_inplace(out);
+            evaluator.add_plain_inplace(out, row.chunks[lane * layout.chunks() + c]);
+            push(out);
+        }
+    }
+}
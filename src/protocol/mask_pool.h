@@ -0,0 +1,165 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../util/trace.h"
+#include "seal/seal.h"
+
+// 결과 ciphertext 에 곱하는 mask (row 마다 새로)
+//
+// slot 마다 lane 을 넘치지 않는 홀수 (Packing::odd_mask). 2^r 의 배수인 lane 은 곱한 뒤에도
+// 0 이 아닌 2^r 의 배수로 남고, 나머지 lane 은 균등한 홀수배로 섞여서 교집합 판정만 남음.
+// 난수는 SEAL 의 CSPRNG (기본 factory, Blake2xb) 에서 slot 전체 분량을 한 번에 받는다.
+// encode 한 뒤 NTT form 으로 바꿔 두므로 평가 때 multiply_plain 이 mask 의 NTT 를 하지 않음
+// (evaluate_row). NTT form plaintext 는 coeff_count * coeff_modulus 개 word 라서 encode 만 한
+// 것보다 큼.
+//
+// labeled mode 의 label ciphertext 는 lane 구조가 없으므로 [1, t) 균등 mask (MaskKind::uniform):
+// x != y 인 slot 의 (x - y) * mask 가 0 이 아닌 균등한 값이 되어 label 이 가려짐 (protocol/labels.h).
+// mask 가 0 이면 x != y 인 slot 에도 label 이 그대로 남으므로 0 은 버리고 다시 뽑는다.
+enum class MaskKind { odd_lanes, uniform };
+
+template <class Packing>
+class MaskGenerator {
+public:
+    MaskGenerator(const seal::SEALContext& context,
+                  const seal::BatchEncoder& batch_encoder,
+                  const seal::Evaluator& evaluator,
+                  MaskKind kind = MaskKind::odd_lanes)
+        : batch_encoder_(batch_encoder), evaluator_(evaluator),
+          parms_id_(context.first_parms_id()),   // client 가 새로 암호화한 query 와 같은 level
+          plain_modulus_(context.first_context_data()->parms().plain_modulus().value()),
+          kind_(kind),
+          prng_(seal::UniformRandomGeneratorFactory::DefaultFactory()->create()),
+          slots_(batch_encoder.slot_count()) {}
+
+    void generate(seal::Plaintext& out) {
+        prng_->generate(slots_.size() * sizeof(std::uint64_t), reinterpret_cast<seal::seal_byte*>(slots_.data()));
+        if (kind_ == MaskKind::odd_lanes) {
+            for (auto& v : slots_) v = Packing::odd_mask(v);
+        } else {
+            for (auto& v : slots_) {
+                v %= plain_modulus_;   // t < 2^61 이라 편향은 무시할 만함
+                while (v == 0) {
+                    prng_->generate(sizeof(v), reinterpret_cast<seal::seal_byte*>(&v));
+                    v %= plain_modulus_;
+                }
+            }
+        }
+        batch_encoder_.encode(slots_, out);
+        evaluator_.transform_to_ntt_inplace(out, parms_id_);
+    }
+
+private:
+    const seal::BatchEncoder& batch_encoder_;
+    const seal::Evaluator&    evaluator_;
+    seal::parms_id_type       parms_id_;
+    std::uint64_t             plain_modulus_;
+    MaskKind                  kind_;
+    std::shared_ptr<seal::UniformRandomGenerator> prng_;   // thread 하나에서만
+    std::vector<std::uint64_t> slots_;
+};
+
+// session 하나의 mask pool: background thread 가 capacity 개까지 미리 만들어 두고
+// 평가 loop 는 row 마다 take() 로 하나씩 꺼내 한 번만 쓴다.
+// setup 직후부터 채우므로 table encoding / client 의 query 암호화 동안 찬다.
+// pool 이 비면 take() 가 그 자리에서 생성 (기다리지 않음, generated_inline 으로 셈).
+// capacity 0 이면 thread 없이 항상 그 자리에서 생성.
+template <class Packing>
+class MaskPool {
+public:
+    MaskPool(const seal::SEALContext& context,
+             const seal::BatchEncoder& batch_encoder,
+             const seal::Evaluator& evaluator,
+             size_t capacity,
+             TraceRecorder* trace = nullptr,
+             MaskKind kind = MaskKind::odd_lanes)
+        : capacity_(capacity), trace_(trace),
+          fill_gen_(context, batch_encoder, evaluator, kind), inline_gen_(context, batch_encoder, evaluator, kind)
+    {
+        if (capacity_ > 0) {
+            int lane = trace_ ? trace_->lane(kind == MaskKind::odd_lanes ? "mask pool" : "label mask pool") : 0;
+            fill_thread_ = std::thread([this, lane] { fill(lane); });
+        }
+    }
+
+    MaskPool(const MaskPool&)            = delete;
+    MaskPool& operator=(const MaskPool&) = delete;
+
+    ~MaskPool() {
+        if (fill_thread_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            cv_space_.notify_all();
+            fill_thread_.join();
+        }
+    }
+
+    seal::Plaintext take() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!ready_.empty()) {
+                seal::Plaintext mask = std::move(ready_.front());
+                ready_.pop_front();
+                ++taken_pooled_;
+                cv_space_.notify_one();
+                return mask;
+            }
+        }
+        seal::Plaintext mask;
+        {
+            TraceSpan span(trace_, "mask.inline", "mask");
+            inline_gen_.generate(mask);
+        }
+        ++taken_inline_;   // take() 는 평가 thread 하나에서만
+        return mask;
+    }
+
+    size_t capacity() const { return capacity_; }
+    size_t taken_pooled() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return taken_pooled_;
+    }
+    size_t generated_inline() const { return taken_inline_; }
+
+private:
+    void fill(int lane) {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_space_.wait(lock, [this] { return ready_.size() < capacity_ || stopping_; });
+                if (stopping_) return;
+            }
+            seal::Plaintext mask;
+            try {
+                TraceSpan span(trace_, "mask", "mask", lane);
+                fill_gen_.generate(mask);
+            } catch (...) {
+                return;   // 채우기를 멈추면 take() 가 그 자리에서 생성
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            ready_.push_back(std::move(mask));
+        }
+    }
+
+    const size_t capacity_;
+    TraceRecorder* trace_;
+    MaskGenerator<Packing> fill_gen_;     // fill thread 전용
+    MaskGenerator<Packing> inline_gen_;   // take() 전용
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_space_;
+    std::deque<seal::Plaintext> ready_;
+    size_t taken_pooled_ = 0;
+    size_t taken_inline_ = 0;
+    bool stopping_ = false;
+    std::thread fill_thread_;
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "../hashing/cuckoo.h"
+#include "../hashing/p_cuckoo.h"
+#include "context_cache.h"
+#include "server_eval.h"
+#include "table_cache.h"
+#include "seal/seal.h"
+
+// Server-pinned hash 조합 (offline / online 분리)
+//
+// 기본 protocol 에서는 client 가 hash 20개 중 조합을 고르므로 server 는 chosen_hashes 를
+// 받기 전까지 table 을 인코딩할 수 없다. pinned 모드에서는 server 가 segment 개수마다
+// 조합 하나를 미리 정해 (hash 협상 응답에 index 로 같이 보냄) table + plaintext 인코딩을
+// 시작할 때 끝내 둔다. client 가 그 조합으로 cuckoo 에 성공하면 online 은
+// query 수신 -> 평가 -> 결과 전송뿐이다. 실패하면 client 는 기존처럼 직접 고르고
+// (fallback), server 는 그 session 만 table 을 online 으로 만든다.
+
+inline bool same_hash_params(const HashParams& a, const HashParams& b) {
+    return a.c0 == b.c0 && a.c1 == b.c1 && a.c2 == b.c2 && a.c3 == b.c3 &&
+           a.prime == b.prime && a.seed == b.seed && a.mod == b.mod;
+}
+
+inline bool same_hash_params(const std::vector<HashParams>& a, const std::vector<HashParams>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (!same_hash_params(a[i], b[i])) return false;
+    return true;
+}
+
+// all_hashes 중 k 개 조합을 순서대로 시험해서, 크기 set_size 인 random set num_trials 개에
+// 모두 cuckoo 가 성공하는 첫 조합의 index. 없으면 빈 vector.
+// (fixed hash 들은 조합에 따라 실패율 차이가 커서 아무 조합이나 고정하면 안 됨)
+inline std::vector<size_t> choose_pinned_combination(
+    size_t bins,
+    size_t r,
+    size_t threshold,
+    const std::vector<HashParams>& all_hashes,
+    size_t k,
+    size_t set_size,
+    size_t num_trials)
+{
+    // 시험용 set 은 고정 seed 라 server 를 다시 띄워도 같은 조합이 나옴
+    std::mt19937_64 rng(0x50494e4e4544ull + bins);
+    const uint32_t domain_mask = (uint32_t(1) << 22) - 1;   // x 는 22 bit
+    std::vector<std::vector<uint32_t>> trial_sets(num_trials);
+    for (auto& set : trial_sets) {
+        std::unordered_set<uint32_t> seen;
+        while (seen.size() < set_size) seen.insert(static_cast<uint32_t>(rng()) & domain_mask);
+        set.assign(seen.begin(), seen.end());
+    }
+
+    for (const auto& comb : get_combinations(all_hashes.size(), k)) {
+        bool ok = true;
+        for (const auto& set : trial_sets) {
+            PermCuckooTable table(bins, threshold, r, comb, all_hashes);
+            if (table.insert_all(set) != 0) {
+                ok = false;
+                break;
+            }
+        }
+        if (ok) return comb;
+    }
+    return {};
+}
+
+struct PinnedSet {
+    size_t bins = 0;
+    std::vector<size_t>     indices;   // generate_fixed_hash_functions(bins, 20) 에서의 index
+    std::vector<HashParams> hashes;
+    seal::parms_id_type     parms_id{};   // rows 를 인코딩한 parms
+    ServerPlaintexts        rows;         // [h][seg][row]
+};
+
+// 시작할 때 만들고 이후 읽기 전용 (session thread 들이 lock 없이 find)
+class PinnedHashes {
+public:
+    // segment 개수 num_segments 에 대한 조합을 고르고 table + encoding 을 미리 함.
+    // 조합은 load factor trial_load 인 random set 들로 고르므로 client set 의 load 가
+    // 그 이하면 대부분 성공하고, 넘으면 client 가 fallback 할 가능성이 커진다.
+    // (eviction 을 쫓겨난 원소의 hash 기준으로 이어가므로 3-조합 하나가 load 0.9 정도까지
+    //  random set 을 넣고, trial_load 가 그보다 낮으면 첫 조합이 거의 항상 고정됨)
+    template <class Packing>
+    const PinnedSet& precompute(
+        size_t num_segments,
+        size_t slot_count,
+        size_t threshold,
+        double trial_load,
+        ServerTableCache& tables,
+        const ServerCrypto& crypto)
+    {
+        PinnedSet pin;
+        pin.bins = num_segments * slot_count;
+        auto all_hashes = generate_fixed_hash_functions(pin.bins, 20);
+
+        size_t set_size = static_cast<size_t>(trial_load * static_cast<double>(pin.bins));
+        pin.indices = choose_pinned_combination(
+            pin.bins, Packing::r, threshold, all_hashes, 3, set_size, 16);
+        if (pin.indices.empty())
+            throw std::runtime_error("no hash combination to pin for " + std::to_string(num_segments) + " segment(s)");
+
+        for (auto idx : pin.indices) pin.hashes.push_back(all_hashes[idx]);
+        pin.parms_id = crypto.parms.parms_id();
+        pin.rows = encode_server_tables<Packing>(
+            tables.get_all(pin.bins, pin.hashes), slot_count, crypto.batch_encoder);
+
+        auto it = pinned_.insert_or_assign(pin.bins, std::move(pin)).first;
+        return it->second;
+    }
+
+    const PinnedSet* find(size_t bins) const {
+        auto it = pinned_.find(bins);
+        return it == pinned_.end() ? nullptr : &it->second;
+    }
+
+    bool empty() const { return pinned_.empty(); }
+
+private:
+    std::map<size_t, PinnedSet> pinned_;
+};
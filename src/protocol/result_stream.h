@@ -0,0 +1,493 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../network/async_wire.h"
+#include "../network/psi_wire.h"
+#include "../network/send_pipeline.h"
+#include "../network/transport.h"
+#include "../network/wire.h"
+#include "../util/trace.h"
+#include "seal/seal.h"
+
+// 결과 ciphertext 전송 (server -> client)
+//
+// 연결 하나 (기본):
+//   (hash, segment) 마다 [개수][ct]... 순서로 main 연결에 보냄 (기존 방식)
+//
+// striping (client 가 --stripes=N, N > 1):
+//   client 가 setup 때 stripe 개수를 보내면 server 가 token 을 돌려주고,
+//   client 는 연결 N-1 개를 더 열어 [kHelloStripe][token][stripe index] 를 보낸다.
+//   server 는 모든 (hash, segment) 의 개수를 main 연결로 먼저 보낸 뒤,
+//   ct 를 [seq][ct] 로 감싸서 큐가 가장 짧은 stripe 로 보낸다 (stripe 마다 I/O thread).
+//   끝나면 모든 stripe 에 kStripeEnd. client 는 stripe 마다 thread 로 받아서 seq 순서로 재조립.
+//
+// 모든 새 연결은 첫 메시지로 kHelloSession 또는 kHelloStripe 를 보냄.
+// 한 session 에서 query 를 여러 번 보낼 수 있으므로 stripe 연결도 session 동안 재사용.
+constexpr std::uint64_t kHelloSession = 0x5053490000000001ull;
+constexpr std::uint64_t kHelloStripe  = 0x5053490000000002ull;
+constexpr std::uint64_t kStripeEnd    = ~std::uint64_t(0);
+
+// setup 뒤 client 가 query 마다 앞에 붙이는 값 (kQueryEnd 면 session 종료).
+// kQueryRehash 는 새 chosen_hashes 가 뒤따름: 같은 bins 의 hash 20개 중 다른 조합을 고른 경우
+constexpr std::uint64_t kQueryEnd    = 0;
+constexpr std::uint64_t kQueryNext   = 1;
+constexpr std::uint64_t kQueryRehash = 2;
+
+inline std::uint64_t new_stripe_token() {
+    std::random_device rd;
+    std::uint64_t t = 0;
+    while (t == 0)   // 0 은 "striping 안 함"
+        t = (static_cast<std::uint64_t>(rd()) << 32) ^ rd();
+    return t;
+}
+
+// ======================== server ========================
+
+class ResultSender {
+public:
+    // counts: (hash, segment) 순서 (hash major) 의 ciphertext 개수.
+    // trace 가 있으면 직렬화와 stripe 별 전송을 span 으로 (lane "send I/O <stripe>")
+    ResultSender(
+        Wire& main,
+        const std::vector<Wire*>& extra_stripes,
+        size_t pipeline_depth,
+        std::vector<std::uint64_t> counts,
+        TraceRecorder* trace = nullptr)
+        : counts_(std::move(counts)), striped_(!extra_stripes.empty()), trace_(trace)
+    {
+        auto lane = [&](size_t i) { return trace_ ? trace_->lane("send I/O " + std::to_string(i)) : 0; };
+        if (striped_) {
+            for (auto c : counts_) send_u64(main, c);
+            main.flush();
+            pipes_.push_back(std::make_unique<SendPipeline>(main, pipeline_depth, trace_, lane(0)));
+            for (Wire* w : extra_stripes)
+                pipes_.push_back(std::make_unique<SendPipeline>(*w, pipeline_depth, trace_, lane(pipes_.size())));
+        } else {
+            pipes_.push_back(std::make_unique<SendPipeline>(main, pipeline_depth, trace_, lane(0)));
+        }
+    }
+
+    ResultSender(const ResultSender&)            = delete;
+    ResultSender& operator=(const ResultSender&) = delete;
+
+    void push(std::vector<uint8_t> buf) {
+        if (!striped_) {
+            // 새 (hash, segment) 에 들어가면 개수 먼저 (개수 0 인 칸은 건너뜀)
+            while (remaining_ == 0) {
+                if (cell_ == counts_.size())
+                    throw std::logic_error("more result ciphertexts than announced");
+                remaining_ = counts_[cell_++];
+                pipes_[0]->push_u64(remaining_);
+            }
+            --remaining_;
+            pipes_[0]->push_bytes(std::move(buf));
+            return;
+        }
+
+        // 큐가 가장 짧은 stripe (같으면 round robin)
+        size_t best = rr_ % pipes_.size();
+        size_t best_q = pipes_[best]->queued();
+        for (size_t i = 1; i < pipes_.size() && best_q > 0; ++i) {
+            size_t s = (rr_ + i) % pipes_.size();
+            size_t q = pipes_[s]->queued();
+            if (q < best_q) {
+                best   = s;
+                best_q = q;
+            }
+        }
+        ++rr_;
+        pipes_[best]->push_u64(seq_++);
+        pipes_[best]->push_bytes(std::move(buf));
+    }
+
+    template <class T>
+    void push_seal_obj(const T& obj) {
+        std::vector<uint8_t> buf;
+        {
+            TraceSpan span(trace_, "serialize", "serialize");
+            buf = serialize_seal_obj(obj);
+        }
+        push(std::move(buf));
+    }
+
+    void finish() {
+        if (!striped_) {
+            // 남은 (개수 0 인) 칸의 개수도 보내야 client 가 기다리지 않음
+            while (cell_ < counts_.size()) pipes_[0]->push_u64(counts_[cell_++]);
+        } else {
+            for (auto& p : pipes_) p->push_u64(kStripeEnd);
+        }
+        std::exception_ptr first_error;
+        for (auto& p : pipes_) {
+            try {
+                p->finish();
+            } catch (...) {
+                if (!first_error) first_error = std::current_exception();
+            }
+        }
+        if (first_error) std::rethrow_exception(first_error);
+    }
+
+    size_t num_stripes() const { return pipes_.size(); }
+
+    std::uint64_t io_idle_us() const {
+        std::uint64_t s = 0;
+        for (const auto& p : pipes_) s += p->io_idle_us();
+        return s;
+    }
+    std::uint64_t producer_blocked_us() const {
+        std::uint64_t s = 0;
+        for (const auto& p : pipes_) s += p->producer_blocked_us();
+        return s;
+    }
+
+private:
+    std::vector<std::uint64_t> counts_;
+    bool striped_;
+    TraceRecorder* trace_;
+    std::vector<std::unique_ptr<SendPipeline>> pipes_;
+
+    size_t cell_              = 0;   // 비 striping: 다음 (hash, segment)
+    std::uint64_t remaining_  = 0;   // 비 striping: 현재 칸에 남은 ct 수
+    std::uint64_t seq_        = 0;   // striping: 다음 sequence number
+    size_t rr_                = 0;
+};
+
+// session 이 stripe 연결을 기다리는 시간 (token 을 보낸 뒤부터)
+constexpr std::chrono::milliseconds kStripeTimeout{10000};
+
+// daemon 모드: accept loop 가 받은 stripe 연결을 token 별로 모아두고 session 이 가져감
+//
+// session 이 token 을 client 에 보내기 전에 expect 로 등록한 token 만 받는다.
+// 등록된 token 은 deadline 이 있어서, session 이 wait 하지 않고 끝났거나 timeout 뒤에
+// 늦게 온 연결은 deliver / wait 때 같이 버려짐 (등록이 안 된 token, 범위 밖 index 는 예외).
+class StripeRegistry {
+public:
+    void expect(std::uint64_t token, size_t n, std::chrono::milliseconds ttl) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        drop_expired(clock::now());
+        if (entries_.size() >= kMaxPending) throw std::runtime_error("too many pending stripe tokens");
+        Entry& e   = entries_[token];
+        e.n        = n;
+        e.deadline = clock::now() + ttl;
+        e.wires.clear();
+    }
+
+    void deliver(std::uint64_t token, std::uint64_t idx, std::unique_ptr<Wire> wire) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            drop_expired(clock::now());
+            auto it = entries_.find(token);
+            if (it == entries_.end()) throw std::runtime_error("stripe connection with an unknown token");
+            Entry& e = it->second;
+            if (idx == 0 || idx > e.n) throw std::runtime_error("stripe index out of range");
+            if (e.wires.count(idx)) throw std::runtime_error("duplicate stripe connection");
+            e.wires[idx] = std::move(wire);
+        }
+        cv_.notify_all();
+    }
+
+    // stripe 1..n 을 index 순서로 리턴. timeout 안에 다 안 오면 예외. 어느 쪽이든 token 은 지움
+    std::vector<std::unique_ptr<Wire>> wait(
+        std::uint64_t token, size_t n, std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = entries_.find(token);
+        if (it == entries_.end() || it->second.n != n)
+            throw std::runtime_error("stripe token was not registered");
+        it->second.deadline = std::max(it->second.deadline, clock::now() + timeout);
+
+        bool ok = cv_.wait_for(lock, timeout, [&] {
+            auto e = entries_.find(token);
+            return e == entries_.end() || e->second.wires.size() >= n;
+        });
+
+        std::vector<std::unique_ptr<Wire>> out;
+        it = entries_.find(token);
+        if (it == entries_.end()) ok = false;
+        if (ok) {
+            for (size_t i = 1; i <= n; ++i) out.push_back(std::move(it->second.wires.at(i)));
+        }
+        if (it != entries_.end()) entries_.erase(it);
+        drop_expired(clock::now());
+        if (!ok) throw std::runtime_error("stripe connections did not arrive");
+        return out;
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Entry {
+        size_t n = 0;
+        clock::time_point deadline;
+        std::map<std::uint64_t, std::unique_ptr<Wire>> wires;
+    };
+
+    // mutex_ 를 잡은 상태에서 호출
+    void drop_expired(clock::time_point now) {
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            if (it->second.deadline <= now) it = entries_.erase(it);
+            else ++it;
+        }
+    }
+
+    static constexpr size_t kMaxPending = 1024;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<std::uint64_t, Entry> entries_;
+};
+
+// 새 연결의 첫 메시지. stripe 연결이면 token / index 가 뒤따름
+struct ConnectionHello {
+    std::uint64_t kind  = 0;
+    std::uint64_t token = 0;
+    std::uint64_t idx   = 0;
+};
+
+// 연결만 하고 hello 를 안 보내는 client 가 accept 하는 thread 를 붙잡지 않도록
+// hello 는 짧은 timeout 으로 받음 (넘으면 예외). 다 받으면 timeout 해제
+constexpr std::chrono::milliseconds kHelloTimeout{5000};
+
+inline ConnectionHello recv_hello(Wire& wire) {
+    ConnectionHello h;
+    wire.set_recv_timeout(kHelloTimeout);
+    h.kind = recv_u64(wire);
+    if (h.kind == kHelloStripe) {
+        h.token = recv_u64(wire);
+        h.idx   = recv_u64(wire);
+    } else if (h.kind != kHelloSession) {
+        throw std::runtime_error("unexpected connection hello");
+    }
+    wire.set_recv_timeout(std::chrono::milliseconds(0));
+    return h;
+}
+
+// listener 에서 다음 session 연결을 받음. 도중에 온 stripe 연결은 registry 로 넘김.
+// hello 가 늦거나 잘못된 연결은 버리고 다음 연결을 받음
+inline std::unique_ptr<Wire> accept_session(
+    WireListener& listener, const TransportConfig& cfg, StripeRegistry& registry)
+{
+    for (;;) {
+        auto wire = accept_wire(listener, cfg);
+        ConnectionHello hello;
+        try {
+            hello = recv_hello(*wire);
+        } catch (const std::exception& e) {
+            std::cerr << "[accept] dropped connection: " << e.what() << "\n";
+            continue;
+        }
+        if (hello.kind == kHelloSession) return wire;
+        try {
+            registry.deliver(hello.token, hello.idx, std::move(wire));
+        } catch (const std::exception& e) {
+            std::cerr << "[accept] dropped stripe connection: " << e.what() << "\n";
+        }
+    }
+}
+
+// one-shot 서버: listener 에서 stripe 연결 n 개를 직접 받음
+inline std::vector<std::unique_ptr<Wire>> accept_stripes(
+    WireListener& listener, const TransportConfig& cfg, std::uint64_t token, size_t n)
+{
+    StripeRegistry registry;
+    registry.expect(token, n, kStripeTimeout);
+    for (size_t i = 0; i < n; ++i) {
+        auto wire = accept_wire(listener, cfg);
+        ConnectionHello hello = recv_hello(*wire);
+        if (hello.kind != kHelloStripe)
+            throw std::runtime_error("expected a stripe connection");
+        registry.deliver(hello.token, hello.idx, std::move(wire));
+    }
+    return registry.wait(token, n, std::chrono::milliseconds(0));
+}
+
+// ======================== client ========================
+
+class ResultReceiver {
+public:
+    // query 하나의 결과 수신.
+    // extra_stripes 가 비어 있으면 main 하나로 받음 (socket 이면 AsyncWire, shm 이면 동기).
+    // trace 가 있으면 결과를 기다린 시간 ("recv wait") 과 역직렬화를 span 으로
+    ResultReceiver(
+        Wire& main,
+        const std::vector<Wire*>& extra_stripes,
+        size_t num_cells,
+        TraceRecorder* trace = nullptr)
+        : main_(main), extra_(extra_stripes), cells_left_(num_cells), trace_(trace)
+    {
+        if (!extra_.empty()) {
+            counts_.resize(num_cells);
+            for (auto& c : counts_) c = recv_u64(main_);
+
+            stripes_.push_back(&main_);
+            for (Wire* w : extra_) stripes_.push_back(w);
+            running_ = stripes_.size();
+            for (size_t i = 0; i < stripes_.size(); ++i) {
+                int lane = trace_ ? trace_->lane("stripe recv " + std::to_string(i)) : 0;
+                threads_.emplace_back([this, w = stripes_[i], lane] { stripe_loop(*w, lane); });
+            }
+        } else if (main_.pollable()) {
+            async_ = std::make_unique<AsyncWire>(main_);
+            if (cells_left_ > 0) next_count_ = async_->recv_u64();
+        }
+    }
+
+    ResultReceiver(const ResultReceiver&)            = delete;
+    ResultReceiver& operator=(const ResultReceiver&) = delete;
+
+    ~ResultReceiver() {
+        try {
+            finish();
+        } catch (...) {
+        }
+    }
+
+    // 다음 (hash, segment) 의 ciphertext 개수
+    std::uint64_t next_count() {
+        if (cells_left_ == 0) throw std::logic_error("no more result cells");
+        --cells_left_;
+        if (!stripes_.empty()) return counts_[counts_.size() - cells_left_ - 1];
+        if (!async_) return recv_u64(main_);
+
+        if (pending_count_) {   // 직전 칸에 receive() 를 안 부른 경우
+            next_count_    = async_->recv_u64();
+            pending_count_ = false;
+        }
+        std::uint64_t n = next_count_.get();
+        // 다음 칸 개수는 이 칸의 ct 들 뒤에 오므로 receive() 에서 미리 요청
+        pending_count_ = cells_left_ > 0;
+        return n;
+    }
+
+    void receive(std::uint64_t num_ct, std::vector<seal::Ciphertext>& out,
+                 const seal::SEALContext& context)
+    {
+        out.resize(num_ct);
+        if (!stripes_.empty()) {
+            for (auto& ct : out) {
+                std::vector<uint8_t> buf;
+                {
+                    TraceSpan span(trace_, "recv wait", "io");
+                    buf = take(seq_++);
+                }
+                TraceSpan span(trace_, "deserialize", "serialize");
+                load_seal_obj(buf, ct, context);
+            }
+        } else if (async_) {
+            std::vector<std::future<std::vector<uint8_t>>> bufs;
+            bufs.reserve(num_ct);
+            for (std::uint64_t i = 0; i < num_ct; ++i) bufs.push_back(async_->recv_bytes());
+            if (pending_count_) {
+                next_count_    = async_->recv_u64();
+                pending_count_ = false;
+            }
+            for (std::uint64_t i = 0; i < num_ct; ++i) {
+                std::vector<uint8_t> buf;
+                {
+                    TraceSpan span(trace_, "recv wait", "io");
+                    buf = bufs[i].get();
+                }
+                TraceSpan span(trace_, "deserialize", "serialize");
+                load_seal_obj(buf, out[i], context);
+            }
+        } else {
+            for (auto& ct : out) {
+                TraceSpan span(trace_, "recv", "io");
+                recv_seal_obj(main_, ct, context);
+            }
+        }
+    }
+
+    // stripe thread 정리 + stripe 별 통신 통계를 main 에 합침 (stripe 쪽은 다음 query 를 위해 reset)
+    void finish() {
+        if (finished_) return;
+        finished_ = true;
+
+        if (async_) async_->detach();
+        for (auto& t : threads_) t.join();
+
+        for (size_t i = 0; i < extra_.size(); ++i) {
+            Wire& w = *extra_[i];
+            std::cout << "[client] stripe " << (i + 1) << ": "
+                      << w.bytes_recv() << " B, recv " << w.recv_time_us() / 1000.0 << " ms\n";
+            main_.add_stats(w.bytes_sent(), w.bytes_recv(), w.send_time_us(), w.recv_time_us());
+            w.reset_stats();
+        }
+        if (error_) std::rethrow_exception(error_);
+    }
+
+private:
+    void stripe_loop(Wire& w, int lane) {
+        try {
+            for (;;) {
+                std::uint64_t seq = recv_u64(w);
+                if (seq == kStripeEnd) break;
+                TraceSpan span(trace_, "recv", "io", lane);   // seq 가 온 뒤부터 (payload 수신)
+                auto buf = recv_bytes(w);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    ready_.emplace(seq, std::move(buf));
+                }
+                cv_.notify_all();
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) error_ = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --running_;
+        }
+        cv_.notify_all();
+    }
+
+    std::vector<uint8_t> take(std::uint64_t seq) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return ready_.count(seq) || error_ || running_ == 0; });
+        auto it = ready_.find(seq);
+        if (it == ready_.end()) {
+            if (error_) std::rethrow_exception(error_);
+            throw std::runtime_error("stripe closed before all results arrived");
+        }
+        auto buf = std::move(it->second);
+        ready_.erase(it);
+        return buf;
+    }
+
+    Wire& main_;
+    std::vector<Wire*> extra_;
+    size_t cells_left_;
+    TraceRecorder* trace_;
+    bool finished_ = false;
+
+    // 단일 연결 + AsyncWire
+    std::unique_ptr<AsyncWire> async_;
+    std::future<std::uint64_t> next_count_;
+    bool pending_count_ = false;
+
+    // striping
+    std::vector<std::uint64_t> counts_;
+    std::vector<Wire*> stripes_;
+    std::vector<std::thread> threads_;
+    std::uint64_t seq_ = 0;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<std::uint64_t, std::vector<uint8_t>> ready_;
+    size_t running_ = 0;
+    std::exception_ptr error_;
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../util/trace.h"
+#include "server_eval.h"
+#include "seal/seal.h"
+
+// streaming server encoding: 평가 순서 (hash -> segment -> row) 대로 row 를 encode 해서
+// 바로 넘기고, 평가가 끝난 row 의 plaintext buffer 는 다음 row 에 재사용한다.
+// session 이 동시에 들고 있는 plaintext 는 window 개 (materialize 하면 k * segment * max_load/d 개).
+//
+//   window == 1 : next() 가 그 자리에서 encode (thread 없음)
+//   window  > 1 : encoder thread 가 window - 1 개까지 미리 encode (평가와 overlap)
+//
+// next() 가 돌려준 plaintext 는 다음 next() 호출 전까지 유효.
+template <class Packing>
+class RowStream {
+public:
+    RowStream(const std::vector<RowEncoder<Packing>>& encoders,
+              const seal::BatchEncoder& batch_encoder,
+              size_t window,
+              TraceRecorder* trace = nullptr)
+        : encoders_(encoders), batch_encoder_(batch_encoder),
+          window_(window == 0 ? 1 : window), trace_(trace), slots_(window_)
+    {
+        for (size_t i = 0; i < window_; ++i) free_.push_back(i);
+        if (window_ > 1) {
+            int lane = trace_ ? trace_->lane("row encoder") : 0;
+            encoder_thread_ = std::thread([this, lane] { produce(lane); });
+        }
+    }
+
+    RowStream(const RowStream&)            = delete;
+    RowStream& operator=(const RowStream&) = delete;
+
+    ~RowStream() {
+        if (encoder_thread_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            cv_free_.notify_all();
+            encoder_thread_.join();
+        }
+    }
+
+    const seal::Plaintext& next() {
+        if (window_ == 1) {
+            if (!advance(cursor_)) throw std::logic_error("RowStream: no more rows");
+            encode(cursor_, 0, 0);
+            return slots_[0].plain;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (current_) {   // 직전 row 는 평가가 끝났으므로 buffer 반납
+            free_.push_back(*current_);
+            current_.reset();
+            cv_free_.notify_one();
+        }
+        cv_ready_.wait(lock, [this] { return !ready_.empty() || error_ || done_; });
+        if (ready_.empty()) {
+            if (error_) std::rethrow_exception(error_);
+            throw std::logic_error("RowStream: no more rows");
+        }
+        current_ = ready_.front();
+        ready_.pop_front();
+        return slots_[*current_].plain;
+    }
+
+private:
+    struct Cursor {
+        size_t h = 0, seg = 0, row = 0;
+        bool started = false;
+    };
+    struct Slot {
+        seal::Plaintext plain;
+        std::vector<std::uint64_t> slots;   // encode 용 buffer
+    };
+
+    // hash -> segment -> row 순서로 다음 위치 (빈 segment 는 건너뜀). 끝이면 false
+    bool advance(Cursor& c) const {
+        if (c.started) ++c.row;
+        c.started = true;
+        while (c.h < encoders_.size()) {
+            if (c.seg < encoders_[c.h].num_segments() && c.row < encoders_[c.h].rows(c.seg)) return true;
+            c.row = 0;
+            if (++c.seg >= encoders_[c.h].num_segments()) {
+                c.seg = 0;
+                ++c.h;
+            }
+        }
+        return false;
+    }
+
+    void encode(const Cursor& c, size_t slot, int lane) {
+        TraceSpan span(trace_, "encode.row", "encode", lane);
+        if (span.enabled()) span.set_args(JsonObject().add("hash", c.h).add("seg", c.seg).add("row", c.row));
+        encoders_[c.h].encode(c.seg, c.row, batch_encoder_, slots_[slot].slots, slots_[slot].plain);
+    }
+
+    void produce(int lane) {
+        try {
+            Cursor c;
+            while (advance(c)) {
+                size_t slot;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    cv_free_.wait(lock, [this] { return !free_.empty() || stopping_; });
+                    if (stopping_) return;
+                    slot = free_.front();
+                    free_.pop_front();
+                }
+                encode(c, slot, lane);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    ready_.push_back(slot);
+                }
+                cv_ready_.notify_one();
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+        }
+        cv_ready_.notify_one();
+    }
+
+    const std::vector<RowEncoder<Packing>>& encoders_;
+    const seal::BatchEncoder& batch_encoder_;
+    const size_t window_;
+    TraceRecorder* trace_;
+    std::vector<Slot> slots_;
+    Cursor cursor_;   // window == 1
+
+    std::mutex mutex_;
+    std::condition_variable cv_free_;
+    std::condition_variable cv_ready_;
+    std::deque<size_t> free_;
+    std::deque<size_t> ready_;
+    std::optional<size_t> current_;
+    bool stopping_ = false;
+    bool done_     = false;
+    std::exception_ptr error_;
+    std::thread encoder_thread_;
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "../hashing/simple.h"
+#include "../util/trace.h"
+#include "seal/seal.h"
+
+// 서버 쪽 encoding / 평가 공용 코드 (단일 process 서버와 shard worker 가 같이 사용)
+
+// server_plaintexts_set[h][seg] = (hash h, query segment seg) 의 plaintext row 들
+using ServerPlaintexts = std::vector<std::vector<std::vector<seal::Plaintext>>>;
+
+// [row][slot] encode 용 buffer. encode_server_tables 가 table / segment 사이에 재사용
+using SlotRows = std::vector<std::vector<std::uint64_t>>;
+
+// simple table 을 (segment, row) 단위로 바로 encode.
+// bin 의 row*d .. row*d+d-1 번째 원소를 그 자리에서 2^r - x_R 로 바꿔 pack 하고, 빈 lane / 빈 bin 은
+// 0 (pad) 으로 채워서 slot buffer 에 한 번에 씀. Packing::pack_table -> split_simple_table_segments
+// -> pad_simple_table_vec -> encode_simple_table 과 같은 plaintext 가 나오지만 중간 사본이 없음.
+// table 은 이 객체보다 오래 살아야 함 (ServerTableCache 의 shared_ptr).
+template <class Packing>
+class RowEncoder {
+public:
+    RowEncoder(const PermSimpleHashTable& table, size_t slot_count)
+        : table_(&table.get_table()), slot_count_(slot_count)
+    {
+        if (slot_count_ == 0 || table_->size() % slot_count_ != 0)
+            throw std::invalid_argument("table size must be a multiple of slot_count");
+        rows_.assign(table_->size() / slot_count_, 0);
+        for (size_t b = 0; b < table_->size(); ++b) {
+            size_t& r = rows_[b / slot_count_];
+            r = std::max(r, Packing::rows((*table_)[b].size()));
+        }
+    }
+
+    size_t num_segments() const { return rows_.size(); }
+    size_t rows(size_t seg) const { return rows_[seg]; }
+
+    // row 하나 (streaming 모드, protocol/row_stream.h). slots 는 호출 사이에 재사용하는 buffer
+    void encode(size_t seg, size_t row, const seal::BatchEncoder& batch_encoder,
+                std::vector<std::uint64_t>& slots, seal::Plaintext& out) const
+    {
+        slots.resize(slot_count_);
+        const auto*  bins = table_->data() + seg * slot_count_;
+        const size_t j    = row * Packing::d;
+        for (size_t i = 0; i < slot_count_; ++i) {
+            const auto& bin = bins[i];
+            slots[i] = bin.size() > j
+                ? Packing::pack_complement(bin.data() + j, std::min<size_t>(Packing::d, bin.size() - j))
+                : 0;
+        }
+        batch_encoder.encode(slots, out);
+    }
+
+    // segment 전체: bin 을 한 번씩만 읽어서 모든 row 의 slot 을 채우고 row 별로 encode.
+    // slot_rows 는 모자랄 때만 늘어나고, out 의 Plaintext 도 이미 있으면 그 memory 를 다시 씀
+    void encode_segment(size_t seg, const seal::BatchEncoder& batch_encoder,
+                        SlotRows& slot_rows, std::vector<seal::Plaintext>& out) const
+    {
+        const size_t n_rows = rows_[seg];
+        if (slot_rows.size() < n_rows) slot_rows.resize(n_rows);
+        for (size_t r = 0; r < n_rows; ++r) slot_rows[r].resize(slot_count_);
+
+        const auto* bins = table_->data() + seg * slot_count_;
+        for (size_t i = 0; i < slot_count_; ++i) {
+            const auto&  bin    = bins[i];
+            const size_t filled = Packing::rows(bin.size());
+            for (size_t r = 0; r < filled; ++r) {
+                const size_t j = r * Packing::d;
+                slot_rows[r][i] = Packing::pack_complement(bin.data() + j, std::min<size_t>(Packing::d, bin.size() - j));
+            }
+            for (size_t r = filled; r < n_rows; ++r) slot_rows[r][i] = 0;
+        }
+
+        out.resize(n_rows);
+        for (size_t r = 0; r < n_rows; ++r) batch_encoder.encode(slot_rows[r], out[r]);
+    }
+
+private:
+    const std::vector<std::vector<uint32_t>>* table_;
+    size_t slot_count_;
+    std::vector<size_t> rows_;   // segment 별 row 개수
+};
+
+// PermSimpleHashTable 하나: [seg][row] plaintext (trace 가 있으면 segment 별 encode 를 span 으로)
+template <class Packing>
+std::vector<std::vector<seal::Plaintext>> encode_server_table(
+    const PermSimpleHashTable& table,
+    size_t slot_count,
+    const seal::BatchEncoder& batch_encoder,
+    SlotRows& slot_rows,
+    TraceRecorder* trace = nullptr)
+{
+    RowEncoder<Packing> encoder(table, slot_count);
+    std::vector<std::vector<seal::Plaintext>> server_plaintexts(encoder.num_segments());
+    for (size_t seg = 0; seg < encoder.num_segments(); ++seg) {
+        TraceSpan span(trace, "encode", "encode");
+        if (span.enabled()) span.set_args(JsonObject().add("seg", seg).add("rows", encoder.rows(seg)));
+        encoder.encode_segment(seg, batch_encoder, slot_rows, server_plaintexts[seg]);
+    }
+    return server_plaintexts;
+}
+
+template <class Packing>
+std::vector<std::vector<seal::Plaintext>> encode_server_table(
+    const PermSimpleHashTable& table,
+    size_t slot_count,
+    const seal::BatchEncoder& batch_encoder,
+    TraceRecorder* trace = nullptr)
+{
+    SlotRows slot_rows;
+    return encode_server_table<Packing>(table, slot_count, batch_encoder, slot_rows, trace);
+}
+
+template <class Packing>
+ServerPlaintexts encode_server_tables(
+    const std::vector<PermSimpleHashTable>& server_tables,
+    size_t slot_count,
+    const seal::BatchEncoder& batch_encoder,
+    TraceRecorder* trace = nullptr)
+{
+    ServerPlaintexts server_plaintexts_set;
+    server_plaintexts_set.reserve(server_tables.size());
+    SlotRows slot_rows;
+    for (const auto& table : server_tables)
+        server_plaintexts_set.push_back(encode_server_table<Packing>(table, slot_count, batch_encoder, slot_rows, trace));
+    return server_plaintexts_set;
+}
+
+// ServerTableCache 에서 공유 중인 table 용
+template <class Packing>
+ServerPlaintexts encode_server_tables(
+    const std::vector<std::shared_ptr<const PermSimpleHashTable>>& server_tables,
+    size_t slot_count,
+    const seal::BatchEncoder& batch_encoder,
+    TraceRecorder* trace = nullptr)
+{
+    ServerPlaintexts server_plaintexts_set;
+    server_plaintexts_set.reserve(server_tables.size());
+    SlotRows slot_rows;
+    for (const auto& table : server_tables)
+        server_plaintexts_set.push_back(encode_server_table<Packing>(*table, slot_count, batch_encoder, slot_rows, trace));
+    return server_plaintexts_set;
+}
+
+// query + row 후 mask 곱하기.
+// mask 가 NTT form 이면 (protocol/mask_pool.h) ciphertext 를 NTT 로 옮겨 곱하고 되돌림:
+// multiply_plain 이 어차피 하는 ciphertext NTT 는 그대로고 mask 의 NTT 만 빠짐
+inline void evaluate_row(
+    const seal::Evaluator& evaluator,
+    const seal::Ciphertext& query_ct,
+    const seal::Plaintext& row,
+    const seal::Plaintext& mask,
+    seal::Ciphertext& destination)
+{
+    evaluator.add_plain(query_ct, row, destination);
+    if (mask.is_ntt_form()) {
+        evaluator.transform_to_ntt_inplace(destination);
+        evaluator.multiply_plain_inplace(destination, mask);
+        evaluator.transform_from_ntt_inplace(destination);
+    } else {
+        evaluator.multiply_plain_inplace(destination, mask);
+    }
+}
+
+// row 하나당 결과 ciphertext 하나
+inline std::vector<seal::Ciphertext> evaluate_rows(
+    const seal::Evaluator& evaluator,
+    const seal::Ciphertext& query_ct,
+    const std::vector<seal::Plaintext>& rows,
+    const seal::Plaintext& mask)
+{
+    std::vector<seal::Ciphertext> compare_results(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        evaluate_row(evaluator, query_ct, rows[i], mask, compare_results[i]);
+    }
+    return compare_results;
+}
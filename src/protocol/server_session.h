@@ -0,0 +1,531 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "../hashing/cuckoo.h"
+#include "../hashing/simple.h"
+#include "../network/psi_wire.h"
+#include "../network/wire.h"
+#include "../util/phase_timer.h"
+#include "../util/trace.h"
+#include "context_cache.h"
+#include "labels.h"
+#include "mask_pool.h"
+#include "pinned_tables.h"
+#include "result_stream.h"
+#include "row_stream.h"
+#include "server_eval.h"
+#include "shard.h"
+#include "table_cache.h"
+#include "seal/seal.h"
+
+// 서버 쪽 PSI session 하나 (client 연결 하나)
+//
+// psi_server 의 one-shot 모드와 daemon 모드가 같이 사용.
+// 비샤딩 모드에서는 table 을 ServerTableCache 에서 받아오므로 같은 segment 개수를 쓰는
+// session 들은 table build 를 한 번만 한다.
+//
+// setup (hash 협상, parms/pk, chosen_hashes, stripe) 은 연결당 한 번이고, 이후 client 는
+// [kQueryNext][query ct...] (labeled mode 면 뒤에 [label key ct...]) 를 여러 번 보낼 수 있다. context, evaluator, 인코딩된 row 는
+// session 동안 유지되고 mask 만 query 마다 새로 만든다. 새 set 이 지금 hash 조합으로
+// cuckoo 에 안 들어가면 client 는 [kQueryRehash][chosen_hashes] 로 조합만 바꾼다
+// (bins 가 같으므로 table 은 cache 에서 옴). kQueryEnd 로 종료.
+// phase_sink 가 있으면 session 이 끝날 때 phase 별 시간/byte 를 JSON 한 줄로 기록
+// (setup/{negotiate,context,stripes,tables}, query[i]/{rehash,recv_query,evaluate}).
+//
+// trace_path 가 있으면 session 의 span 들을 Chrome trace JSON 으로 저장 (util/trace.h).
+// session clock: server 는 key cache 답을 보낸 순간을, client 는 그 답을 기다린 구간의 중간을
+// 같은 시점으로 보고 (NTP 와 같은 방식, 오차 <= RTT/2), client 가 setup 때 보내는
+// "connect 시작 ~ 그 시점" (us) 만큼 앞을 0 으로 둔다. 그래서 두 trace 의 ts 가 같은 축.
+
+// client 가 고른 hash 들이 server 가 보낸 hash 20개 중에 있는지 (그 밖의 hash 로 table 을 만들지 않음)
+inline void check_chosen_hashes(const std::vector<HashParams>& chosen,
+                                const std::vector<HashParams>& all)
+{
+    if (chosen.empty() || chosen.size() > all.size())
+        throw std::runtime_error("invalid number of chosen hash functions");
+    for (const auto& h : chosen) {
+        bool known = std::any_of(all.begin(), all.end(),
+                                 [&](const HashParams& a) { return same_hash_params(h, a); });
+        if (!known) throw std::runtime_error("client chose a hash function the server did not offer");
+    }
+}
+
+struct ServerSessionConfig {
+    size_t slot_count     = 0;
+    size_t pipeline_depth = 0;
+    size_t max_stripes = 16;
+    ServerContextCache* contexts = nullptr;   // 없으면 session 마다 context 생성
+    const PinnedHashes* pinned   = nullptr;   // 있으면 해당 bins 의 hash 조합 + 인코딩된 row 를 미리 가짐
+    PhaseSink* phase_sink        = nullptr;   // session 마다 JSON record 하나 (util/phase_timer.h)
+    std::string trace_path;                   // 있으면 이 session 의 Chrome trace 를 저장
+    // > 0 이면 row 를 미리 encode 해 두지 않고 query 마다 평가 직전에 encode (protocol/row_stream.h).
+    // session 이 들고 있는 plaintext 가 window 개로 줄어드는 대신 query 마다 encode 비용이 듦
+    size_t stream_window = 0;
+    // row 마다 새 mask 를 background 에서 미리 만들어 두는 개수 (protocol/mask_pool.h, 0: 그 자리에서 생성)
+    size_t mask_pool = 32;
+    // 있으면 labeled mode: 결과 row 마다 label ciphertext 를 붙여서 교집합 원소의 label 도 보냄
+    // (protocol/labels.h, 샤딩 / stream_window 와는 같이 못 씀)
+    const ServerLabels* labels = nullptr;
+    // client 가 striping 을 요청하면 token 으로 추가 연결 n 개를 받아오는 함수 (없으면 striping 안 함)
+    std::function<std::vector<std::unique_ptr<Wire>>(std::uint64_t token, size_t n)> accept_stripes;
+    // 있으면 token 을 client 에 보내기 전에 호출 (daemon 의 StripeRegistry 에 token 등록)
+    std::function<void(std::uint64_t token, size_t n)> expect_stripes;
+};
+
+template <class Packing>
+void serve_psi_session(
+    Wire& wire,
+    const ServerSessionConfig& cfg,
+    ServerTableCache* tables,   // 비샤딩 모드
+    ShardPool* shards)          // 샤딩 모드 (둘 중 하나만)
+{
+    const size_t slot_count = cfg.slot_count;
+    PhaseRegistry phases("server");
+    std::unique_ptr<TraceRecorder> trace;
+    if (!cfg.trace_path.empty()) {
+        trace = std::make_unique<TraceRecorder>("server", 1);
+        trace->name_thread("session");
+        phases.set_trace(trace.get());
+    }
+    std::optional<PhaseScope> setup_scope;
+    setup_scope.emplace(phases, "setup", wire);
+
+    // ---- client key material: fingerprint 만 먼저 받고 cache 에 있는 것을 알려줌 ----
+    // (답은 첫 hash 협상 응답 앞에 같이 가므로 왕복이 늘지 않음)
+    seal::parms_id_type parms_id = recv_parms_id(wire);
+    std::uint64_t key_fp = recv_u64(wire);
+    ServerContextCache::CryptoPtr crypto;
+    ServerContextCache::KeyPtr public_key;
+    if (cfg.contexts) {
+        crypto = cfg.contexts->find(parms_id);
+        if (crypto) public_key = cfg.contexts->find_key(parms_id, key_fp);
+    }
+    send_u64(wire, (crypto ? kHaveContext : 0) | (public_key ? kHavePublicKey : 0));
+    if (cfg.labels && shards) throw std::logic_error("labeled mode cannot be combined with shards");
+    // label row 는 미리 전부 encode 하므로 streaming 의 window 만큼만 들고 있는다는 보장이 깨짐
+    if (cfg.labels && cfg.stream_window > 0)
+        throw std::logic_error("labeled mode cannot be combined with a stream window");
+    const LabelLayout<Packing> layout(cfg.labels ? cfg.labels->label_bits : 0);
+    send_u64(wire, layout.label_bits());   // 0: unlabeled
+    wire.flush();
+    const auto sync_point = TraceRecorder::clock::now();   // session clock 기준점
+    const bool context_cached = crypto != nullptr;
+    const bool key_cached     = public_key != nullptr;
+
+    // ---- client 와 query segment 개수 협상 (bins = segments * slot_count) ----
+    // client 가 보낸 segment 개수로 hash 20개를 만들어 보내고, 0 이 오면 확정
+    size_t num_segments = 0;
+    size_t bins         = 0;
+    std::vector<HashParams> all_hashes;
+    std::optional<PhaseScope> negotiate_scope;
+    negotiate_scope.emplace(phases, "negotiate");
+    while (std::uint64_t requested = recv_u64(wire)) {
+        if (requested > kMaxQuerySegments)
+            throw std::runtime_error("client requested too many query segments");
+        num_segments = static_cast<size_t>(requested);
+        bins         = num_segments * slot_count;
+        std::cout << "Query segments: " << num_segments
+                << " (bins = " << bins << ")\n";
+
+        // ------------------ 서버: hash 20개 생성 ------------------
+        all_hashes = generate_fixed_hash_functions(bins, 20);
+
+        // ---- 여기서 클라이언트에게 hash 파라미터 전체 전송 ----
+        send_hash_params(wire, all_hashes);
+
+        // pinned 조합이 있으면 그 index 들 (없으면 0 개): client 가 먼저 시도함
+        const PinnedSet* pin = cfg.pinned ? cfg.pinned->find(bins) : nullptr;
+        send_u64(wire, pin ? pin->indices.size() : 0);
+        if (pin)
+            for (auto idx : pin->indices) send_u64(wire, idx);
+        std::cout << "Sent " << all_hashes.size() << " hash functions to client"
+                  << (pin ? " (with a pinned combination)" : "") << ".\n";
+    }
+    negotiate_scope.reset();
+    if (num_segments == 0) throw std::runtime_error("client did not request any query segment");
+
+    // ---- 여기서부터 클라이언트가 보낸 setup 정보 수신 ----
+
+    // 1) parms 수신 (cache 에 없을 때만, context 없이)
+    std::optional<PhaseScope> ctx_scope;
+    ctx_scope.emplace(phases, "context");
+    if (!crypto) {
+        seal::EncryptionParameters parms(seal::scheme_type::bfv);
+        recv_seal_parms(wire, parms);
+        if (parms.parms_id() != parms_id)
+            throw std::runtime_error("client parms do not match the announced parms_id");
+        // context 를 만들기 (cache 에 넣기) 전에 packing 의 parameter set 인지 확인
+        if (parms.poly_modulus_degree() != slot_count ||
+            parms.plain_modulus().bit_count() != static_cast<int>(Packing::plain_bits)) {
+            throw std::runtime_error("client parms do not match the slot packing parameter set");
+        }
+
+        // 2) context 생성 (cache 가 있으면 같은 parms 의 다른 session 과 공유)
+        crypto = cfg.contexts ? cfg.contexts->get(parms) : std::make_shared<const ServerCrypto>(parms);
+    }
+    if (crypto->parms.plain_modulus().bit_count() != static_cast<int>(Packing::plain_bits)) {
+        throw std::runtime_error("plain modulus does not match the slot packing parameter set");
+    }
+    const seal::EncryptionParameters& parms = crypto->parms;
+    const seal::SEALContext& context        = crypto->context;
+
+    // 3) public key 수신 (cache 에 없을 때만, context 필요)
+    if (!public_key) {
+        auto buf = recv_bytes(wire);
+        if (fingerprint_bytes(buf) != key_fp)
+            throw std::runtime_error("client public key does not match the announced fingerprint");
+        auto pk = std::make_shared<seal::PublicKey>();
+        load_seal_obj(buf, *pk, context);
+        if (cfg.contexts) cfg.contexts->put_key(parms_id, key_fp, pk);
+        public_key = std::move(pk);
+    }
+    std::cout << "[server] SEAL context " << (context_cached ? "cached" : "received")
+              << ", public key " << (key_cached ? "cached" : "received") << " ("
+              << ctx_scope->stop().wall_us << " us)\n";
+    ctx_scope.reset();
+
+    // 4) chosen_hashes 수신
+    std::vector<HashParams> chosen_hashes = recv_hash_params(wire);
+    check_chosen_hashes(chosen_hashes, all_hashes);
+
+    // 4-1) client 의 connect 시작이 기준점보다 얼마나 앞인지 (us): trace 의 0 을 맞춤
+    std::uint64_t trace_lead_us = recv_u64(wire);
+    if (trace) trace->set_origin(sync_point - std::chrono::microseconds(trace_lead_us));
+
+    // 5) 결과 전송용 연결 개수 (striping). 허용하면 token 을 보내고 추가 연결을 기다림, 아니면 0
+    std::uint64_t requested_stripes = recv_u64(wire);
+    std::vector<std::unique_ptr<Wire>> stripe_wires;
+    if (requested_stripes > 1 && cfg.accept_stripes) {
+        PhaseScope stripes_scope(phases, "stripes");
+        size_t n_extra = static_cast<size_t>(
+            std::min<std::uint64_t>(requested_stripes, cfg.max_stripes)) - 1;
+        std::uint64_t token = new_stripe_token();
+        if (cfg.expect_stripes) cfg.expect_stripes(token, n_extra);
+        send_u64(wire, token);
+        send_u64(wire, n_extra);
+        wire.flush();
+        stripe_wires = cfg.accept_stripes(token, n_extra);
+        std::cout << "Result striping over " << (n_extra + 1) << " connections\n";
+    } else {
+        send_u64(wire, 0);
+    }
+    std::vector<Wire*> extra_stripes;
+    for (auto& w : stripe_wires) extra_stripes.push_back(w.get());
+
+    // 6) batch_encoder, evaluator 는 context 와 같이 cache 된 것을 사용
+    const seal::BatchEncoder& batch_encoder = crypto->batch_encoder;
+    const seal::Evaluator&    evaluator     = crypto->evaluator;
+
+    // 7) row 마다 쓸 mask 를 지금부터 미리 만들어 둠 (shard 모드에서는 worker 가 만듦)
+    MaskPool<Packing> masks(context, batch_encoder, evaluator, shards ? 0 : cfg.mask_pool, trace.get());
+    std::optional<MaskPool<Packing>> label_masks;   // labeled mode: [1, t) 균등 mask
+    if (layout.labeled())
+        label_masks.emplace(context, batch_encoder, evaluator, cfg.mask_pool, trace.get(), MaskKind::uniform);
+
+    // --- permutation-based simple table (server only) ---
+    // sharded mode 에서는 worker 가 각자 shard 로 table 을 만듦
+    // table 과 encoding 은 session 동안 유지되어 이후 query 들은 evaluation 만 함
+    // client 가 pinned 조합을 골랐고 parms 도 같으면 offline 에 인코딩해 둔 row 를 그대로 씀
+    std::optional<PhaseScope> tables_scope;
+    tables_scope.emplace(phases, "tables");
+    ServerPlaintexts session_plaintexts;
+    const ServerPlaintexts* server_plaintexts = &session_plaintexts;   // [h][seg] = segment seg 의 plaintext row 들
+    std::vector<ServerTableCache::TablePtr> stream_tables;   // streaming 모드: encoder 가 읽는 table
+    std::vector<RowEncoder<Packing>>        row_encoders;    // streaming 모드: hash 별
+    ServerLabelRows label_rows;   // labeled mode: [h][seg][row]
+    std::vector<std::uint64_t> counts;   // (hash, segment) 별 결과 ciphertext 개수
+    bool pinned_rows = false;
+    bool streaming   = false;
+    auto prepare_tables = [&] {
+        counts.clear();
+        if (shards) {
+            counts = shards->collect_counts();   // worker 의 table + encoding 이 끝나면 옴
+            return;
+        }
+        const PinnedSet* pin = cfg.pinned ? cfg.pinned->find(bins) : nullptr;
+        pinned_rows = pin && pin->parms_id == parms.parms_id() && same_hash_params(chosen_hashes, pin->hashes);
+        streaming   = !pinned_rows && cfg.stream_window > 0;
+        row_encoders.clear();
+        stream_tables.clear();
+        label_rows.clear();
+        std::vector<ServerTableCache::TablePtr> server_tables;
+        auto fetch_tables = [&] {
+            TraceSpan span(trace.get(), "simple tables", "hash");
+            server_tables = tables->get_all(bins, chosen_hashes);
+        };
+        if (pinned_rows) {
+            server_plaintexts = &pin->rows;
+            session_plaintexts.clear();
+        } else if (streaming) {
+            // row 개수만 세고 encode 는 query 때 (table 은 cache 가 session 끼리 공유)
+            fetch_tables();
+            stream_tables = server_tables;
+            session_plaintexts.clear();
+            for (const auto& t : stream_tables) {
+                row_encoders.emplace_back(*t, slot_count);
+                for (size_t seg = 0; seg < num_segments; ++seg) counts.push_back(row_encoders.back().rows(seg));
+            }
+        } else {
+            fetch_tables();
+            session_plaintexts = encode_server_tables<Packing>(server_tables, slot_count, batch_encoder, trace.get());
+            server_plaintexts  = &session_plaintexts;
+        }
+        if (!streaming)
+            for (const auto& per_hash : *server_plaintexts)
+                for (const auto& rows : per_hash) counts.push_back(rows.size());
+
+        // labeled mode: label row 는 session 마다 encode (pinned 조합이어도, streaming 은 위에서 거부)
+        if (layout.labeled()) {
+            if (server_tables.empty()) fetch_tables();
+            label_rows = encode_label_tables<Packing>(
+                server_tables, *cfg.labels, layout, slot_count, batch_encoder, trace.get());
+            for (auto& c : counts) c *= layout.cts_per_row();
+        }
+    };
+    if (shards) shards->broadcast_setup(parms, chosen_hashes, num_segments);
+    prepare_tables();
+    auto us_gen_sim = tables_scope->stop().wall_us;
+    tables_scope.reset();
+
+    auto table_mode = [&] {
+        std::string labeled = layout.labeled()
+            ? ", " + std::to_string(layout.label_bits()) + "-bit labels in " + std::to_string(layout.chunks()) + " chunk(s)"
+            : "";
+        if (pinned_rows) return " (pinned hashes, encoded offline" + labeled + ")";
+        if (streaming)   return " (streaming rows, window " + std::to_string(cfg.stream_window) + labeled + ")";
+        size_t held = 0;
+        for (auto c : counts) held += c / layout.cts_per_row();
+        return " (" + std::to_string(held) + " encoded rows held" + labeled + ")";
+    };
+    std::cout << "Permutation simple tables ready in "
+            << us_gen_sim << " us" << (shards ? "" : table_mode()) << std::endl;
+
+    // ==== 통신 통계: preprocessing vs online 분리 ====
+    // setup phase 의 통신이 preprocessing 단계 (hash 20개 전송, parms/pk/ chosen_hashes 수신)
+    const PhaseTimes setup_times = setup_scope->stop();
+    setup_scope.reset();
+    std::uint64_t pre_bytes_s2c = setup_times.bytes_sent; // server -> client
+    std::uint64_t pre_bytes_c2s = setup_times.bytes_recv; // client -> server
+    std::uint64_t pre_us_send   = wire.send_time_us();
+    std::uint64_t pre_us_recv   = wire.recv_time_us();
+
+    double ms_gen_sim = us_gen_sim / 1000.0;
+    std::cout << "\n[server] SIMPLE table time = "
+          << ms_gen_sim
+          << std::endl;
+
+    // 1) preprocessing 단계 (session 당 한 번)
+    double pre_mb_s2c  = pre_bytes_s2c / (1024.0 * 1024.0);
+    double pre_mb_c2s  = pre_bytes_c2s / (1024.0 * 1024.0);
+    double pre_ms_send = pre_us_send / 1000.0;
+    double pre_ms_recv = pre_us_recv / 1000.0;
+
+    std::cout << "\n[server][preprocessing] bytes server->client: "
+              << pre_bytes_s2c << " B (" << pre_mb_s2c << " MB)\n";
+    std::cout << "[server][preprocessing] bytes client->server: "
+              << pre_bytes_c2s << " B (" << pre_mb_c2s << " MB)\n";
+    std::cout << "[server][preprocessing] time send: " << pre_ms_send << " ms, "
+              << "recv: " << pre_ms_recv << " ms, "
+              << "total comm time: " << (pre_ms_send + pre_ms_recv) << " ms\n";
+
+    size_t num_queries = 0;
+
+    // ==== query loop: client 가 kQueryEnd 를 보낼 때까지 같은 setup 으로 반복 ====
+    for (;;) {
+        wire.reset_stats();
+        std::uint64_t cmd = recv_u64(wire);
+        if (cmd == kQueryEnd) break;
+        if (cmd != kQueryRehash && cmd != kQueryNext) {
+            throw std::runtime_error("unexpected query command from client");
+        }
+        ++num_queries;
+        // command 를 받은 뒤부터 (client 의 hash/암호화 시간은 빠짐)
+        PhaseScope query_scope(phases, "query", wire, static_cast<long long>(num_queries));
+        if (cmd == kQueryRehash) {
+            PhaseScope rehash_scope(phases, "rehash");
+            chosen_hashes = recv_hash_params(wire);
+            check_chosen_hashes(chosen_hashes, all_hashes);
+            if (shards) shards->broadcast_rehash(chosen_hashes);
+            prepare_tables();
+            std::cout << "\n[server] client switched to " << chosen_hashes.size()
+                      << " other hash function(s), tables ready in "
+                      << rehash_scope.stop().wall_us
+                      << " us" << (shards ? "" : table_mode()) << "\n";
+        }
+        size_t num_hash = chosen_hashes.size();
+
+        // --- 클라이언트 쿼리 ciphertext 수신 ---
+        std::vector<seal::Ciphertext> query_cts(num_segments);
+        std::vector<seal::Ciphertext> key_cts(layout.labeled() ? num_segments : 0);   // labeled mode (labels.h)
+        {
+            PhaseScope recv_scope(phases, "recv_query");
+            for (auto& ct : query_cts) {
+                recv_seal_obj(wire, ct, context);
+            }
+            for (auto& ct : key_cts) {
+                recv_seal_obj(wire, ct, context);
+            }
+        }
+        std::cout << "\nQuery " << num_queries << ": received " << query_cts.size()
+                  << " query ciphertext(s) from client\n";
+
+        long long total_us_comp = 0;
+        std::optional<PhaseScope> eval_scope;
+        eval_scope.emplace(phases, "evaluate");   // 평가 + 결과 전송 (I/O thread 는 wall 에만)
+
+        if (shards) {
+            // ====================== sharded: worker 에 query broadcast + 결과 중계 ======================
+            auto start_comp = std::chrono::high_resolution_clock::now();
+            shards->broadcast_queries(query_cts);
+            ResultSender sender(wire, extra_stripes, cfg.pipeline_depth, counts);
+            size_t forwarded = shards->forward_results(sender);
+            sender.finish();
+            auto end_comp = std::chrono::high_resolution_clock::now();
+            total_us_comp = std::chrono::duration_cast<std::chrono::microseconds>(
+                                end_comp - start_comp
+                            ).count();
+
+            std::cout << "[server] " << shards->size() << " shards, compare_results = "
+                    << forwarded << " (evaluation + forwarding)\n";
+        } else {
+            // mask 는 row 마다 pool 에서 새로 꺼냄 (lane 을 넘치지 않는 홀수, NTT form)
+            const size_t masks_pooled_before = masks.taken_pooled();
+            const size_t masks_inline_before = masks.generated_inline();
+            const size_t label_masks_before  = layout.labeled() ? label_masks->taken_pooled() + label_masks->generated_inline() : 0;
+
+            // ====================== 서버: compare_results 계산 + 전송 ======================
+            // row 하나 계산할 때마다 직렬화해서 I/O thread 로 넘김 (계산과 전송 overlap)
+            // (hash, segment) 별 ciphertext 개수는 ResultSender 가 보냄 (striping 이면 한 번에 먼저)
+            auto start_online = std::chrono::high_resolution_clock::now();
+            ResultSender pipeline(wire, extra_stripes, cfg.pipeline_depth, counts, trace.get());
+
+            // streaming 모드: row 를 평가 순서대로 encode 해서 받음 (window 개만 살아있음)
+            std::optional<RowStream<Packing>> row_stream;
+            if (streaming) row_stream.emplace(row_encoders, batch_encoder, cfg.stream_window, trace.get());
+
+            for (size_t h = 0; h < num_hash; ++h) {
+                size_t num_results = 0;
+                long long us_comp_h = 0;
+
+                for (size_t seg = 0; seg < num_segments; ++seg) {
+                    const size_t num_rows = streaming ? row_encoders[h].rows(seg)
+                                                      : (*server_plaintexts)[h][seg].size();
+
+                    // query_cts[seg] + server_plaintexts[h][seg][i], 그리고 새 mask 로 곱하고 바로 전송
+                    for (size_t i = 0; i < num_rows; ++i) {
+                        const seal::Plaintext& pt = streaming ? row_stream->next() : (*server_plaintexts)[h][seg][i];
+                        auto start_comp = std::chrono::high_resolution_clock::now();
+                        seal::Ciphertext diff;
+                        {
+                            TraceSpan span(trace.get(), "eval.row", "eval");
+                            if (span.enabled()) span.set_args(JsonObject().add("hash", h).add("seg", seg));
+                            evaluate_row(evaluator, query_cts[seg], pt, masks.take(), diff);
+                        }
+                        auto end_comp = std::chrono::high_resolution_clock::now();
+                        us_comp_h += std::chrono::duration_cast<std::chrono::microseconds>(
+                                        end_comp - start_comp
+                                    ).count();
+
+                        pipeline.push_seal_obj(diff);
+
+                        // labeled mode: 이 row 의 (lane, chunk) label ciphertext 가 바로 뒤에 이어짐
+                        if (layout.labeled()) {
+                            auto start_label = std::chrono::high_resolution_clock::now();
+                            {
+                                TraceSpan span(trace.get(), "eval.labels", "eval");
+                                if (span.enabled()) span.set_args(JsonObject().add("hash", h).add("seg", seg));
+                                evaluate_label_row(evaluator, key_cts[seg], label_rows[h][seg][i], layout, *label_masks,
+                                                   [&](const seal::Ciphertext& ct) { pipeline.push_seal_obj(ct); });
+                            }
+                            // push 가 I/O 에 막힌 시간도 포함 (결과 ct 와 달리 평가와 push 가 섞여 있음)
+                            us_comp_h += std::chrono::duration_cast<std::chrono::microseconds>(
+                                            std::chrono::high_resolution_clock::now() - start_label
+                                        ).count();
+                        }
+                    }
+                    num_results += num_rows * layout.cts_per_row();
+                }
+
+                double ms_comp = us_comp_h / 1000.0;
+                total_us_comp += us_comp_h;
+
+                std::cout << "[server] hash " << h
+                        << " compare_results = " << num_results
+                        << ", comp time = " << ms_comp << " ms\n";
+            }
+            pipeline.finish();
+            auto end_online = std::chrono::high_resolution_clock::now();
+
+            std::cout << "[server] evaluate+send wall time = "
+                    << std::chrono::duration_cast<std::chrono::microseconds>(
+                           end_online - start_online).count() / 1000.0
+                    << " ms (pipeline depth " << cfg.pipeline_depth
+                    << " x " << pipeline.num_stripes() << " connection(s)"
+                    << ", I/O idle " << pipeline.io_idle_us() / 1000.0
+                    << " ms, eval blocked " << pipeline.producer_blocked_us() / 1000.0 << " ms)\n";
+            std::cout << "[server] masks: " << (masks.taken_pooled() - masks_pooled_before) << " from pool, "
+                    << (masks.generated_inline() - masks_inline_before) << " generated inline (pool "
+                    << masks.capacity() << ")\n";
+            if (layout.labeled())
+                std::cout << "[server] label masks: "
+                        << (label_masks->taken_pooled() + label_masks->generated_inline() - label_masks_before)
+                        << " for " << layout.chunks() << " chunk(s) x " << Packing::d << " lane(s) per row\n";
+        }
+        eval_scope.reset();
+
+        double total_ms_comp = total_us_comp / 1000.0;
+        std::cout << "[server] TOTAL compare time = "
+              << total_ms_comp << "\n";
+
+        // 2) online 단계 (query 하나, stripe 연결 포함)
+        for (size_t i = 0; i < stripe_wires.size(); ++i) {
+            Wire& w = *stripe_wires[i];
+            std::cout << "[server] stripe " << (i + 1) << ": " << w.bytes_sent() << " B, send "
+                      << w.send_time_us() / 1000.0 << " ms\n";
+            wire.add_stats(w.bytes_sent(), w.bytes_recv(), w.send_time_us(), w.recv_time_us());
+            w.reset_stats();
+        }
+        double online_mb_s2c  = wire.bytes_sent() / (1024.0 * 1024.0);
+        double online_mb_c2s  = wire.bytes_recv() / (1024.0 * 1024.0);
+        double online_ms_send = wire.send_time_us() / 1000.0;
+        double online_ms_recv = wire.recv_time_us() / 1000.0;
+
+        std::cout << "\n[server][online] bytes server->client: "
+                  << wire.bytes_sent() << " B (" << online_mb_s2c << " MB)\n";
+        std::cout << "[server][online] bytes client->server: "
+                  << wire.bytes_recv() << " B (" << online_mb_c2s << " MB)\n";
+        std::cout << "[server][online] time send: " << online_ms_send << " ms, "
+                  << "recv: " << online_ms_recv << " ms, "
+                  << "total comm time: " << (online_ms_send + online_ms_recv) << " ms\n";
+    }
+
+    std::cout << "[server] session done: " << num_queries << " quer"
+              << (num_queries == 1 ? "y" : "ies") << " on one setup\n";
+
+    if (cfg.phase_sink) {
+        phases.meta().add("r", Packing::r).add("d", Packing::d)
+                     .add("slot_count", slot_count).add("segments", num_segments)
+                     .add("hash_count", chosen_hashes.size()).add("queries", num_queries)
+                     .add("shards", shards ? shards->size() : size_t(1))
+                     .add("stripes", stripe_wires.size() + 1)
+                     .add("pinned", pinned_rows)
+                     .add("stream_window", streaming ? cfg.stream_window : size_t(0))
+                     .add("mask_pool", masks.capacity())
+                     .add("label_bits", layout.label_bits())
+                     .add("context_cached", context_cached).add("key_cached", key_cached);
+        cfg.phase_sink->write(phases);
+    }
+    if (trace) {
+        trace->write(cfg.trace_path);
+        std::cout << "[server] trace written to " << cfg.trace_path << " (" << trace->size() << " spans)\n";
+    }
+}
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../hashing/simple.h"
+#include "../network/psi_wire.h"
+#include "../network/send_pipeline.h"
+#include "../network/wire.h"
+#include "mask_pool.h"
+#include "result_stream.h"
+#include "server_eval.h"
+#include "seal/seal.h"
+
+// Sharded server
+//
+// coordinator 가 server set 을 N 개로 나눠 local worker process 에 맡긴다.
+// coordinator <-> worker 는 socketpair(AF_UNIX) 위의 Wire 로 통신.
+//
+//   coordinator -> worker : num_segments, parms, chosen_hashes   (setup)
+//   worker      -> coord  : row 개수 [h][seg]                    (table/encoding 끝난 뒤)
+//   coordinator -> worker : kQueryNext, query ciphertext [seg]   (broadcast, query 마다)
+//   worker      -> coord  : 결과 ciphertext [h][seg][row]
+//   coordinator -> worker : kQueryRehash, chosen_hashes          (client 가 hash 조합을 바꾼 경우)
+//   worker      -> coord  : row 개수 [h][seg]
+//   coordinator -> worker : kQueryEnd                            (session 끝)
+//
+// coordinator 는 (h, seg) 마다 worker 들의 row 개수를 합해 ResultSender 를 만들고
+// worker 결과를 역직렬화 없이 그대로 client 에 흘려보낸다.
+// client 입장에서는 단일 서버와 똑같은 메시지 순서.
+// worker 연결은 worker 마다 reader thread 가 동시에 받아 queue 에 넣고, client 로는 위 순서대로
+// 꺼내므로 한 worker 가 늦어도 다른 worker 는 queue 깊이만큼 앞서 계산/전송할 수 있다.
+
+// worker process 본체: shard_elems 로 table 을 만들고 평가
+template <class Packing>
+void run_shard_worker(
+    Wire& coord,
+    const std::vector<uint32_t>& shard_elems,
+    size_t shard_idx,
+    size_t slot_count,
+    size_t pipeline_depth,
+    size_t mask_pool)
+{
+    // ---- setup 수신 ----
+    size_t num_segments = static_cast<size_t>(recv_u64(coord));
+    seal::EncryptionParameters parms(seal::scheme_type::bfv);
+    recv_seal_parms(coord, parms);
+    seal::SEALContext context(parms);
+    std::vector<HashParams> chosen_hashes = recv_hash_params(coord);
+
+    seal::BatchEncoder batch_encoder(context);
+    seal::Evaluator    evaluator(context);
+    MaskPool<Packing>  masks(context, batch_encoder, evaluator, mask_pool);
+
+    // ---- shard 의 simple table + encoding (setup 과 rehash 때) ----
+    ServerPlaintexts server_plaintexts_set;
+    size_t num_hash = 0;
+    auto prepare = [&] {
+        auto server_tables = build_permsimple_tables_for_hashes(
+            num_segments * slot_count, Packing::r, chosen_hashes, shard_elems);
+        server_plaintexts_set =
+            encode_server_tables<Packing>(server_tables, slot_count, batch_encoder);
+
+        num_hash = server_plaintexts_set.size();
+        for (size_t h = 0; h < num_hash; ++h)
+            for (size_t seg = 0; seg < num_segments; ++seg)
+                send_u64(coord, server_plaintexts_set[h][seg].size());
+        coord.flush();
+    };
+    prepare();
+
+    std::cout << "[shard " << shard_idx << "] " << shard_elems.size()
+              << " elements encoded\n";
+
+    // ---- query 수신 + 평가 (encoding 은 유지, mask 는 row 마다 새로) ----
+    std::vector<seal::Ciphertext> query_cts(num_segments);
+    for (;;) {
+        std::uint64_t cmd = recv_u64(coord);
+        if (cmd == kQueryEnd) break;
+        if (cmd == kQueryRehash) {
+            chosen_hashes = recv_hash_params(coord);
+            prepare();
+            continue;
+        }
+        for (auto& ct : query_cts)
+            recv_seal_obj(coord, ct, context);
+        // 계산한 row 는 바로 I/O thread 로 넘겨서 coordinator 로 전송
+        SendPipeline pipeline(coord, pipeline_depth);
+        for (size_t h = 0; h < num_hash; ++h) {
+            for (size_t seg = 0; seg < num_segments; ++seg) {
+                for (const auto& pt : server_plaintexts_set[h][seg]) {
+                    seal::Ciphertext diff;
+                    evaluate_row(evaluator, query_cts[seg], pt, masks.take(), diff);
+                    pipeline.push_seal_obj(diff);
+                }
+            }
+        }
+        pipeline.finish();
+    }
+}
+
+class ShardPool {
+public:
+    // server_elems 를 연속 구간 num_shards 개로 나눠 worker 를 fork.
+    // worker_fn(Wire& coord, const std::vector<uint32_t>& shard, size_t shard_idx)
+    // client 연결(accept) 전에 호출해야 worker 가 client socket 을 물려받지 않음.
+    template <class WorkerFn>
+    ShardPool(const std::vector<uint32_t>& server_elems, size_t num_shards, WorkerFn worker_fn) {
+        if (num_shards == 0)
+            throw std::invalid_argument("num_shards must be positive");
+
+        std::cout.flush();
+        for (size_t w = 0; w < num_shards; ++w) {
+            int fds[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+                perror("socketpair");
+                throw std::runtime_error("socketpair");
+            }
+
+            pid_t pid = ::fork();
+            if (pid < 0) {
+                perror("fork");
+                throw std::runtime_error("fork");
+            }
+            if (pid == 0) {
+                // ---- child ----
+                ::close(fds[0]);
+                for (auto& wk : workers_) ::close(wk.wire->fd());
+
+                int rc = 0;
+                try {
+                    size_t begin = server_elems.size() * w / num_shards;
+                    size_t end   = server_elems.size() * (w + 1) / num_shards;
+                    std::vector<uint32_t> shard(server_elems.begin() + begin,
+                                                server_elems.begin() + end);
+                    Wire coord(fds[1], Wire::adopt_fd_t{});
+                    worker_fn(coord, shard, w);
+                } catch (const std::exception& e) {
+                    std::cerr << "[shard " << w << "] " << e.what() << "\n";
+                    rc = 1;
+                }
+                std::cout.flush();
+                ::_exit(rc);
+            }
+
+            // ---- parent ----
+            ::close(fds[1]);
+            workers_.push_back({pid, std::make_unique<Wire>(fds[0], Wire::adopt_fd_t{})});
+        }
+    }
+
+    ShardPool(const ShardPool&)            = delete;
+    ShardPool& operator=(const ShardPool&) = delete;
+
+    ~ShardPool() {
+        for (auto& wk : workers_) {
+            try {
+                send_u64(*wk.wire, kQueryEnd);
+            } catch (...) {
+                // worker 가 이미 죽은 경우
+            }
+            wk.wire.reset();
+            int status = 0;
+            ::waitpid(wk.pid, &status, 0);
+        }
+    }
+
+    size_t size() const { return workers_.size(); }
+
+    void broadcast_setup(
+        const seal::EncryptionParameters& parms,
+        const std::vector<HashParams>& chosen_hashes,
+        size_t num_segments)
+    {
+        auto parms_buf = serialize_seal_obj(parms);
+        for (auto& wk : workers_) {
+            send_u64(*wk.wire, num_segments);
+            send_bytes(*wk.wire, parms_buf);
+            send_hash_params(*wk.wire, chosen_hashes);
+            wk.wire->flush();   // worker 가 바로 table 을 만들기 시작하도록
+        }
+        num_segments_ = num_segments;
+        num_hash_     = chosen_hashes.size();
+    }
+
+    // client 가 hash 조합을 바꿈: worker 가 table 을 다시 만들고 row 개수를 보냄 (collect_counts 로 받음)
+    void broadcast_rehash(const std::vector<HashParams>& chosen_hashes) {
+        for (auto& wk : workers_) {
+            send_u64(*wk.wire, kQueryRehash);
+            send_hash_params(*wk.wire, chosen_hashes);
+            wk.wire->flush();
+        }
+        num_hash_ = chosen_hashes.size();
+    }
+
+    // 직렬화는 한 번만 하고 같은 bytes 를 모든 worker 에 전송
+    void broadcast_queries(const std::vector<seal::Ciphertext>& query_cts) {
+        for (auto& wk : workers_) send_u64(*wk.wire, kQueryNext);
+        for (const auto& ct : query_cts) {
+            auto buf = serialize_seal_obj(ct);
+            for (auto& wk : workers_)
+                send_bytes(*wk.wire, buf);
+        }
+        for (auto& wk : workers_) wk.wire->flush();
+    }
+
+    // worker 들의 row 개수를 받아 (h, seg) 별 합계를 리턴 (broadcast_setup / broadcast_rehash 다음에)
+    std::vector<std::uint64_t> collect_counts() {
+        // row 개수 [w][h][seg]
+        counts_.assign(workers_.size(), {});
+        for (size_t w = 0; w < workers_.size(); ++w) {
+            counts_[w].resize(num_hash_ * num_segments_);
+            for (auto& c : counts_[w])
+                c = recv_u64(*workers_[w].wire);
+        }
+
+        std::vector<std::uint64_t> total(num_hash_ * num_segments_, 0);
+        for (const auto& c : counts_)
+            for (size_t cell = 0; cell < total.size(); ++cell) total[cell] += c[cell];
+        return total;
+    }
+
+    // query 하나의 worker 결과를 client 로 중계 (broadcast_queries 다음에). 전달한 ciphertext 개수를 리턴
+    size_t forward_results(ResultSender& sender) {
+        const size_t num_cells = num_hash_ * num_segments_;
+        std::vector<ForwardQueue> queues(workers_.size());
+        std::vector<std::thread> readers;
+        for (size_t w = 0; w < workers_.size(); ++w) {
+            std::uint64_t total = 0;
+            for (auto c : counts_[w]) total += c;
+            readers.emplace_back([this, &queues, w, total] { read_worker(w, total, queues[w]); });
+        }
+
+        size_t forwarded = 0;
+        std::exception_ptr error;
+        try {
+            for (size_t cell = 0; cell < num_cells; ++cell) {
+                for (size_t w = 0; w < workers_.size(); ++w) {
+                    for (std::uint64_t i = 0; i < counts_[w][cell]; ++i) {
+                        sender.push(queues[w].pop());
+                        ++forwarded;
+                    }
+                }
+            }
+        } catch (...) {
+            error = std::current_exception();
+            for (auto& q : queues) q.abort();   // reader 는 남은 결과를 읽어서 버림
+        }
+        for (auto& t : readers) t.join();
+        if (error) std::rethrow_exception(error);
+        return forwarded;
+    }
+
+private:
+    // worker 하나의 결과 ciphertext (직렬화된 bytes) queue. reader thread -> forward_results
+    class ForwardQueue {
+    public:
+        void push(std::vector<uint8_t> buf) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_full_.wait(lock, [this] { return items_.size() < kDepth || aborted_; });
+            if (aborted_) return;
+            items_.push_back(std::move(buf));
+            lock.unlock();
+            not_empty_.notify_one();
+        }
+
+        std::vector<uint8_t> pop() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [this] { return !items_.empty() || error_; });
+            if (items_.empty()) std::rethrow_exception(error_);
+            auto buf = std::move(items_.front());
+            items_.pop_front();
+            lock.unlock();
+            not_full_.notify_one();
+            return buf;
+        }
+
+        void fail(std::exception_ptr e) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                error_ = e;
+            }
+            not_empty_.notify_all();
+        }
+
+        void abort() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                aborted_ = true;
+                items_.clear();
+            }
+            not_full_.notify_all();
+        }
+
+    private:
+        static constexpr size_t kDepth = 32;   // worker 가 다른 worker 보다 앞설 수 있는 ciphertext 수
+        std::mutex mutex_;
+        std::condition_variable not_empty_;
+        std::condition_variable not_full_;
+        std::deque<std::vector<uint8_t>> items_;
+        std::exception_ptr error_;
+        bool aborted_ = false;
+    };
+
+    // worker w 의 결과 total 개를 받는 대로 queue 에 넣음 (이 query 동안 w 의 wire 는 이 thread 만 씀)
+    void read_worker(size_t w, std::uint64_t total, ForwardQueue& queue) {
+        try {
+            for (std::uint64_t i = 0; i < total; ++i)
+                queue.push(recv_bytes(*workers_[w].wire));
+        } catch (...) {
+            queue.fail(std::current_exception());
+        }
+    }
+
+    struct Worker {
+        pid_t pid;
+        std::unique_ptr<Wire> wire;
+    };
+    std::vector<Worker> workers_;
+    std::vector<std::vector<std::uint64_t>> counts_;   // [w][h * num_segments + seg]
+    size_t num_segments_ = 0;
+    size_t num_hash_     = 0;
+};
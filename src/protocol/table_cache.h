@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "../hashing/hash_params.h"
+#include "../hashing/simple.h"
+
+// 서버 집합 + permutation simple table 공유 cache
+//
+// server set 은 한 번 로드해서 읽기 전용으로 들고 있고, table 은 (bins, hash) 마다
+// 처음 요청될 때 한 번만 만든다. 같은 table 을 동시에 요청하면 뒤의 session 은 먼저
+// 시작한 build 를 기다림. 만들어진 table 은 shared_ptr<const> 로 여러 session 이 공유.
+//
+// hash 는 generate_fixed_hash_functions(bins, 20) 로 정해지므로 segment 개수가 같은
+// client 들은 같은 table 을 쓰게 된다.
+class ServerTableCache {
+public:
+    using TablePtr = std::shared_ptr<const PermSimpleHashTable>;
+
+    ServerTableCache(std::vector<uint32_t> server_elems, size_t r)
+        : server_elems_(std::move(server_elems)), r_(r) {}
+
+    ServerTableCache(const ServerTableCache&)            = delete;
+    ServerTableCache& operator=(const ServerTableCache&) = delete;
+
+    const std::vector<uint32_t>& server_elems() const { return server_elems_; }
+
+    TablePtr get(size_t bins, const HashParams& hash) {
+        Key key{bins, hash.c0, hash.c1, hash.c2, hash.c3, hash.prime, hash.seed, hash.mod};
+
+        std::promise<TablePtr> promise;
+        std::shared_future<TablePtr> fut;
+        bool build = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = tables_.find(key);
+            if (it == tables_.end()) {
+                fut = promise.get_future().share();
+                tables_.emplace(key, fut);
+                build = true;
+            } else {
+                fut = it->second;
+            }
+        }
+
+        if (build) {
+            try {
+                auto table = std::make_shared<PermSimpleHashTable>(
+                    bins, r_, std::vector<HashParams>{hash});
+                table->insert_all(server_elems_);
+                promise.set_value(std::move(table));
+            } catch (...) {
+                // 실패한 key 는 지워서 다음 요청이 다시 만들 수 있게
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    tables_.erase(key);
+                }
+                promise.set_exception(std::current_exception());
+            }
+        }
+        return fut.get();
+    }
+
+    std::vector<TablePtr> get_all(size_t bins, const std::vector<HashParams>& hashes) {
+        std::vector<TablePtr> out;
+        out.reserve(hashes.size());
+        for (const auto& h : hashes) out.push_back(get(bins, h));
+        return out;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return tables_.size();
+    }
+
+private:
+    // bins + hash 계수 (name 은 표시용이라 제외)
+    using Key = std::tuple<size_t, uint64_t, uint64_t, uint64_t, uint64_t,
+                           uint64_t, uint64_t, uint64_t>;
+
+    const std::vector<uint32_t> server_elems_;
+    const size_t r_;
+
+    mutable std::mutex mutex_;
+    std::map<Key, std::shared_future<TablePtr>> tables_;
+};
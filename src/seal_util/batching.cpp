@@ -2,7 +2,7 @@
 
 
 Ciphertext batch_encrypt_cuckoo_bins_range(
-    const vector<uint32_t> &cuckoo_bins, // 전체 bin
+    const vector<uint64_t> &cuckoo_bins, // 전체 bin (SlotPacker 로 복제된 값)
     size_t start_idx,
     size_t end_idx, // [start_idx, end_idx] 구간만 batching
     Encryptor &encryptor,
@@ -21,7 +21,7 @@ Ciphertext batch_encrypt_cuckoo_bins_range(
     
     // (2) 구간만 복사 (맨 앞에서부터 range_size만큼)
     for (size_t i = 0; i < range_size; ++i)
-        slots[i] = static_cast<uint64_t>(cuckoo_bins[start_idx + i]);
+        slots[i] = cuckoo_bins[start_idx + i];
 
     // (3) Batch encode & encrypt
     Plaintext plain;
@@ -31,4 +31,34 @@ Ciphertext batch_encrypt_cuckoo_bins_range(
     encryptor.encrypt(plain, encrypted);
 
     return encrypted;
-}
\ No newline at end of file
+}
+
+size_t num_query_segments(
+    size_t set_size,
+    size_t slot_count,
+    double max_load_factor)
+{
+    size_t segments = 1;
+    while (static_cast<double>(set_size) / static_cast<double>(segments * slot_count)
+           > max_load_factor)
+        segments <<= 1;
+    return segments;
+}
+
+vector<Ciphertext> batch_encrypt_cuckoo_bins_segments(
+    const vector<uint64_t> &cuckoo_bins,
+    Encryptor &encryptor,
+    BatchEncoder &batch_encoder)
+{
+    size_t slot_count = batch_encoder.slot_count();
+    if (cuckoo_bins.empty() || cuckoo_bins.size() % slot_count != 0)
+        throw invalid_argument("Bin count must be a multiple of slot count!");
+
+    vector<Ciphertext> result;
+    result.reserve(cuckoo_bins.size() / slot_count);
+    for (size_t start = 0; start < cuckoo_bins.size(); start += slot_count) {
+        result.push_back(batch_encrypt_cuckoo_bins_range(
+            cuckoo_bins, start, start + slot_count - 1, encryptor, batch_encoder));
+    }
+    return result;
+}
@@ -8,9 +8,22 @@ using namespace seal;
 using namespace std;
 
 Ciphertext batch_encrypt_cuckoo_bins_range(
-    const vector<uint32_t> &cuckoo_bins, // 전체 bin
+    const vector<uint64_t> &cuckoo_bins, // 전체 bin (SlotPacker 로 복제된 값)
     size_t start_idx,
     size_t end_idx, // [start_idx, end_idx] 구간만 batching
     Encryptor &encryptor,
     BatchEncoder &batch_encoder);
 
+// client set 크기에 맞는 query ciphertext(segment) 개수.
+// load factor 가 max_load_factor 이하가 되는 가장 작은 2의 거듭제곱을 고름
+// (bins = segments * slot_count 도 2의 거듭제곱으로 유지)
+size_t num_query_segments(
+    size_t set_size,
+    size_t slot_count,
+    double max_load_factor);
+
+// 전체 cuckoo bin 을 slot_count 단위 segment 로 나눠서 segment 마다 ciphertext 하나
+vector<Ciphertext> batch_encrypt_cuckoo_bins_segments(
+    const vector<uint64_t> &cuckoo_bins,
+    Encryptor &encryptor,
+    BatchEncoder &batch_encoder);
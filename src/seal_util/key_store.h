@@ -0,0 +1,46 @@
+#pragma once
+
+#include "seal/seal.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// client key 를 파일에 저장 / 재사용 (--key-file)
+//
+// public key 는 만들 때마다 bytes 가 달라지므로 secret key 와 같이 저장해야
+// 다음 실행에서 server 의 key cache (fingerprint) 가 맞는다.
+// 파일이 없거나 지금 parms 와 맞지 않으면 false.
+inline bool load_client_keys(
+    const std::string& path,
+    const seal::SEALContext& context,
+    seal::SecretKey& secret_key,
+    seal::PublicKey& public_key)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    try {
+        secret_key.load(context, in);
+        public_key.load(context, in);
+    } catch (const std::exception& e) {
+        std::cerr << "Ignoring key file " << path << ": " << e.what() << "\n";
+        return false;
+    }
+    return true;
+}
+
+inline void save_client_keys(
+    const std::string& path,
+    const seal::SecretKey& secret_key,
+    const seal::PublicKey& public_key)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("cannot write key file: " + path);
+    secret_key.save(out);
+    public_key.save(out);
+    out.close();
+    // secret key 가 들어 있으므로 owner 만 읽게
+    std::filesystem::permissions(path,
+        std::filesystem::perms::owner_read | std::filesystem::perms::owner_write,
+        std::filesystem::perm_options::replace);
+}
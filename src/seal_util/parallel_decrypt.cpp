@@ -0,0 +1,70 @@
+#include "parallel_decrypt.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+ParallelDecryptor::ParallelDecryptor(
+    const seal::SEALContext& context,
+    const seal::SecretKey& secret_key,
+    size_t num_threads)
+{
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t t = 0; t < num_threads; ++t) {
+        decryptors_.push_back(std::make_unique<seal::Decryptor>(context, secret_key));
+        encoders_.push_back(std::make_unique<seal::BatchEncoder>(context));
+    }
+    plains_.resize(num_threads);
+    slot_count_ = encoders_[0]->slot_count();
+}
+
+void ParallelDecryptor::decrypt_decode(
+    const std::vector<seal::Ciphertext>& cts,
+    std::vector<std::vector<uint64_t>>& slots)
+{
+    if (slots.size() < cts.size())
+        slots.resize(cts.size());
+
+    size_t n_threads = std::min(decryptors_.size(), cts.size());
+    std::vector<int> lanes(std::max<size_t>(n_threads, 1), 0);   // worker 0 은 호출 thread
+    if (trace_)
+        for (size_t t = 1; t < n_threads; ++t) lanes[t] = trace_->lane("decrypt " + std::to_string(t));
+
+    // ciphertext 단위 work stealing (atomic index)
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto work = [&](size_t t) {
+        try {
+            for (size_t i = next++; i < cts.size(); i = next++) {
+                TraceSpan span(trace_, "decrypt", "decrypt", lanes[t]);
+                decryptors_[t]->decrypt(cts[i], plains_[t]);
+                encoders_[t]->decode(plains_[t], slots[i]);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) error = std::current_exception();
+            next = cts.size();
+        }
+    };
+
+    if (n_threads <= 1) {
+        work(0);
+        if (error) std::rethrow_exception(error);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(n_threads - 1);
+    for (size_t t = 1; t < n_threads; ++t)
+        threads.emplace_back(work, t);
+    work(0);
+    for (auto& th : threads)
+        th.join();
+    if (error) std::rethrow_exception(error);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "seal/seal.h"
+#include "../util/trace.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// client 결과 ciphertext 병렬 복호 + decode
+//
+// thread 마다 Decryptor / BatchEncoder 를 따로 두고 (Decryptor 는 thread-safe 가 아님),
+// 결과 slot buffer 는 호출 사이에 재사용해서 매번 slot_count 크기 할당을 하지 않음.
+class ParallelDecryptor {
+public:
+    // num_threads == 0 이면 hardware_concurrency
+    ParallelDecryptor(
+        const seal::SEALContext& context,
+        const seal::SecretKey& secret_key,
+        size_t num_threads = 0);
+
+    size_t num_threads() const { return decryptors_.size(); }
+    size_t slot_count() const { return slot_count_; }
+
+    // ciphertext 마다 "decrypt" span (worker thread 는 lane "decrypt <t>"). nullptr 이면 끔
+    void set_trace(TraceRecorder* trace) { trace_ = trace; }
+
+    // slots[i] = decode(decrypt(cts[i])), i < cts.size()
+    // slots 는 필요하면 늘리기만 하고 줄이지 않음 (buffer 재사용)
+    void decrypt_decode(
+        const std::vector<seal::Ciphertext>& cts,
+        std::vector<std::vector<uint64_t>>& slots);
+
+private:
+    size_t slot_count_;
+    std::vector<std::unique_ptr<seal::Decryptor>>    decryptors_;
+    std::vector<std::unique_ptr<seal::BatchEncoder>> encoders_;
+    std::vector<seal::Plaintext>                     plains_;   // thread 별 임시 plaintext
+    TraceRecorder* trace_ = nullptr;
+};
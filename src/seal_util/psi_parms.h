@@ -0,0 +1,18 @@
+#pragma once
+
+#include "seal/seal.h"
+
+// PSI 용 BFV parameter (client 와 server 가 똑같이 만들어야 함)
+//
+// client 는 이 parms 로 key 를 만들어 보내고, server 는 pinned 모드에서 같은 parms 로
+// table 을 미리 인코딩한다 (parms_id 가 같아야 그 row 를 씀).
+template <class Packing>
+seal::EncryptionParameters make_psi_parms(int log_poly_mod) {
+    seal::EncryptionParameters parms(seal::scheme_type::bfv);
+    size_t poly_modulus_degree = size_t(1) << log_poly_mod;
+    parms.set_poly_modulus_degree(poly_modulus_degree);
+    parms.set_coeff_modulus(seal::CoeffModulus::Create(
+        poly_modulus_degree, {60, 49}));  // 109-bit Q
+    parms.set_plain_modulus(seal::PlainModulus::Batching(poly_modulus_degree, Packing::plain_bits));
+    return parms;
+}
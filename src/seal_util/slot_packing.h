@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// d-way slot packing
+//
+// 각 BFV slot 을 d 개의 lane 으로 나눠서 사용한다.
+//   client : 같은 x_R 을 모든 lane 에 복제           -> x_R | x_R << w | ...
+//   server : bin 의 연속된 d 개 원소를 2^r - y_R 로 바꿔서 lane 별로 pack
+//   ct + pt 후 lane = x_R + 2^r - y_R  (0 < lane < 2^(r+1))
+//   홀수 mask 를 곱해도 lane 이 2^r 의 배수인 경우는 x_R == y_R 일 때뿐이다.
+//
+// lane 하나에 r+1 bit (합) + mask bit 가 필요하고, 최상위 lane 도 plain modulus
+// 아래에 있어야 하므로 d = (plain_bits - 1) / (r + 1 + min_mask_bits).
+// 남는 bit 는 lane 폭에 나눠 주고 mask 로 쓴다.
+template <unsigned PlainBits, unsigned R, unsigned MinMaskBits = 2>
+class SlotPacker {
+public:
+    static constexpr unsigned plain_bits = PlainBits;
+    static constexpr unsigned r          = R;
+    static constexpr unsigned d          = (PlainBits - 1) / (R + 1 + MinMaskBits);
+    static_assert(d >= 1, "plain modulus too small for a single lane");
+    static_assert(PlainBits <= 61, "packed slot must fit below a 61-bit plain modulus");
+
+    static constexpr unsigned lane_bits = (PlainBits - 1) / d;
+    static constexpr unsigned mask_bits = lane_bits - R - 1;
+    static constexpr uint64_t lane_mask = (uint64_t(1) << lane_bits) - 1;
+    static constexpr uint64_t r_val     = uint64_t(1) << R;
+
+    // plaintext row 개수 (bin 당 max_load 개 원소 -> ceil(max_load / d) 행)
+    static constexpr size_t rows(size_t max_load) { return (max_load + d - 1) / d; }
+
+    // client: x_R 을 d 개 lane 에 모두 복제
+    static constexpr uint64_t replicate(uint32_t x_r) {
+        uint64_t v = 0;
+        for (unsigned j = 0; j < d; ++j)
+            v |= static_cast<uint64_t>(x_r) << (j * lane_bits);
+        return v;
+    }
+
+    // server: ys[0..n) (n <= d) 를 2^r - y_R 로 바꿔서 pack, 빈 lane 은 0
+    static uint64_t pack_complement(const uint32_t* ys, size_t n) {
+        uint64_t v = 0;
+        for (size_t j = 0; j < n && j < d; ++j)
+            v |= (r_val - ys[j]) << (j * lane_bits);
+        return v;
+    }
+
+    static constexpr uint64_t lane(uint64_t slot, unsigned j) {
+        return (slot >> (j * lane_bits)) & lane_mask;
+    }
+
+    // lane 이 0 이 아닌 2^r 의 배수이면 교집합 원소
+    static constexpr bool is_match(uint64_t lane_val) {
+        return lane_val != 0 && (lane_val & (r_val - 1)) == 0;
+    }
+
+    static unsigned count_matches(uint64_t slot) {
+        unsigned c = 0;
+        for (unsigned j = 0; j < d; ++j)
+            c += is_match(lane(slot, j));
+        return c;
+    }
+
+    // 임의의 난수를 [1, 2^mask_bits) 범위의 홀수 mask 로 변환
+    static constexpr uint64_t odd_mask(uint64_t rnd) {
+        return ((rnd << 1) | 1) & ((uint64_t(1) << mask_bits) - 1);
+    }
+
+    // simple table 의 각 bin 을 d 개씩 묶어 pack (padding 은 하지 않음)
+    static std::vector<std::vector<uint64_t>>
+    pack_table(const std::vector<std::vector<uint32_t>>& table) {
+        std::vector<std::vector<uint64_t>> packed(table.size());
+        for (size_t b = 0; b < table.size(); ++b) {
+            const auto& bin_vec = table[b];
+            auto& out = packed[b];
+            out.reserve(rows(bin_vec.size()));
+            for (size_t j = 0; j < bin_vec.size(); j += d) {
+                size_t n = bin_vec.size() - j < d ? bin_vec.size() - j : d;
+                out.push_back(pack_complement(bin_vec.data() + j, n));
+            }
+        }
+        return packed;
+    }
+};
+
+// ---- 표준 parameter set (x 는 22bit, r = 22 - log_bins) ----
+// psi_server / psi_client    : log_poly_mod = 14, 27-bit plain modulus -> d = 2
+using Packing2D = SlotPacker<27, 22 - 14>;
+// psi_server_1d / psi_client_1d : log_poly_mod = 12, 23-bit plain modulus -> d = 1
+using Packing1D = SlotPacker<23, 22 - 12>;
+
+static_assert(Packing2D::d == 2, "2D parameter set should pack two values per slot");
+static_assert(Packing1D::d == 1, "1D parameter set should pack one value per slot");
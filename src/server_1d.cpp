@@ -1,28 +1,56 @@
-#include "seal_util/examples.h"
-#include "seal_util/batching.h"
 #include "data/data_generator.h"
 #include "data/data_reader.h"
-#include "hashing/cuckoo.h"
-#include "hashing/simple.h"
-#include "hashing/p_cuckoo.h"
-#include "network/wire.h"
-#include "network/psi_wire.h"
+#include "network/transport.h"
+#include "pcpsi/psi_server.h"
+#include "util/cli.h"
 #include <filesystem>
 #include <iostream>
-#include "seal/seal.h"
-
-using namespace std;
-using namespace seal;
+#include <stdexcept>
 
 int main(int argc, char** argv) {
-    // 1. 클라이언트 연결을 기다리는 Wire (서버 모드)
-    int port = 9000;
-    if (argc > 1) {
-        port = std::stoi(argv[1]);
+    // usage: psi_server [port] [--shards=N] [--pipeline-depth=N]
+    //                   [--daemon [--workers=N]] [--precompute-segments=1,2,...]
+    //                   [--transport=tcp|unix|shm] [--socket-path=/tmp/pcpsi.sock]
+    //                   [--pinned-segments=1,2,... [--pinned-load=0.2]] [--phase-log=phases.jsonl]
+    //                   [--trace=server_trace.json] [--stream-window=N] [--mask-pool=32]
+    //                   [--labels=labels.txt [--label-bits=32]]
+    CliArgs args(argc, argv);
+    int    port           = args.positional_int(0, 9000);
+    TransportConfig transport = TransportConfig::from_args(args, "0.0.0.0", port);
+    bool   daemon         = args.has("daemon");
+    size_t num_workers    = static_cast<size_t>(args.get_int("workers", 4));
+
+    PsiServerOptions opts;
+    opts.num_shards          = static_cast<size_t>(args.get_int("shards", 1));
+    opts.pipeline_depth      = static_cast<size_t>(args.get_int("pipeline-depth", 8));   // 0: 동기 전송
+    opts.precompute_segments = args.get_size_list("precompute-segments");
+    opts.pinned_segments     = args.get_size_list("pinned-segments");
+    opts.phase_log           = args.get("phase-log", "");   // session 마다 phase timing JSON 한 줄
+    opts.trace_file          = args.get("trace", "");       // session 마다 Chrome trace
+    opts.stream_window       = static_cast<size_t>(args.get_int("stream-window", 0));   // 0: row 를 미리 encode
+    opts.mask_pool           = static_cast<size_t>(args.get_int("mask-pool", 32));     // 0: mask 를 그 자리에서 생성
+    if (daemon && opts.num_shards > 1) {
+        // shard worker 는 session 하나만 처리하고 끝나므로 daemon 과 같이 못 씀
+        throw std::invalid_argument("--daemon cannot be combined with --shards");
+    }
+    if (!opts.pinned_segments.empty() && opts.num_shards > 1) {
+        // shard worker 는 각자 table 을 만들므로 coordinator 가 미리 인코딩할 수 없음
+        throw std::invalid_argument("--pinned-segments cannot be combined with --shards");
+    }
+    if (opts.stream_window > 0 && opts.num_shards > 1) {
+        throw std::invalid_argument("--stream-window cannot be combined with --shards");
+    }
+    if (args.has("labels") && opts.num_shards > 1) {
+        throw std::invalid_argument("--labels cannot be combined with --shards");
+    }
+    if (args.has("labels") && opts.stream_window > 0) {
+        // label row 는 미리 전부 encode 하므로 window 만큼의 메모리 한도가 깨짐
+        throw std::invalid_argument("--labels cannot be combined with --stream-window");
+    }
+    opts.pinned_load = args.get_double("pinned-load", 0.2);   // pinned 조합을 고를 때의 load factor
+    if (!(opts.pinned_load > 0 && opts.pinned_load <= 1)) {
+        throw std::invalid_argument("--pinned-load must be in (0, 1]");
     }
-    std::cout << "Server listening on port " << port << "...\n";
-    Wire wire(port);   // 여기서 listen + accept 한번 수행됨
-    std::cout << "Client connected.\n";
 
     // ------------------ server data 생성/로드 ------------------
     int    server_exp  = 20;
@@ -43,190 +71,23 @@ int main(int argc, char** argv) {
     auto server_elems = read_uint32_file(server_path);
     std::cout << "Loaded " << server_elems.size() << " server elements\n";
 
-    // ------------------ 공통 파라미터 ------------------
-    int    log_poly_mod = 12;
-    size_t log_bins     = log_poly_mod;
-    size_t bins         = 1 << log_bins;
-    size_t hash_count   = 3;
-    size_t threshold    = 3000;
-    size_t r            = 22 - log_bins; // 나중에 server_tables 만들 때도 사용
-
-    // ------------------ 서버: hash 20개 생성 ------------------
-    auto all_hashes = generate_fixed_hash_functions(bins, 20);
-
-    // ---- 여기서 클라이언트에게 hash 파라미터 전체 전송 ----
-    send_hash_params(wire, all_hashes);
-    std::cout << "Sent " << all_hashes.size() << " hash functions to client.\n";
-
-    // (뒤에서 parms/pk/ chosen_hashes, query ct 등을 받는 코드는
-    //  다음 단계에서 이어서 넣으면 됨)
-    // ---- 여기서부터 클라이언트가 보낸 setup 정보 수신 ----
-
-    // 1) parms 수신 (context 없이)
-    seal::EncryptionParameters parms(seal::scheme_type::bfv);
-    recv_seal_parms(wire, parms);
-
-    // 2) context 생성
-    seal::SEALContext context(parms);
-
-    // 3) public key 수신 (context 필요)
-    seal::PublicKey public_key;
-    recv_seal_obj(wire, public_key, context);
-
-    // 4) chosen_hashes 수신
-    std::vector<HashParams> chosen_hashes = recv_hash_params(wire);
-
-    // 5) 이후 batch_encoder, evaluator 등 생성
-    seal::BatchEncoder batch_encoder(context);
-    seal::Evaluator   evaluator(context);
-
-    // 이제 server_elems, chosen_hashes, batch_encoder, evaluator 를 써서
-    // permutation simple table 만들고, 나중에 ct_all 받아서 HE 연산 하면 됨.
-
-    // --- permutation-based simple table generation (server only) ---
-    auto start_gen_sim = std::chrono::high_resolution_clock::now();
-    auto server_tables = build_permsimple_tables_for_hashes(
-        bins,         // client/서버가 공유하는 bin 수
-        r,            // 동일한 r
-        chosen_hashes,
-        server_elems  // 서버의 실제 집합
-    );
-    auto end_gen_sim = std::chrono::high_resolution_clock::now();
-    auto us_gen_sim = std::chrono::duration_cast<std::chrono::microseconds>(
-                        end_gen_sim - start_gen_sim
-                    ).count();
-
-    std::cout << "Permutation simple tables generated in "
-            << us_gen_sim << " us" << std::endl;
-
-
-    // ==== 통신 통계: preprocessing vs online 분리 ====
-    // 지금까지의 통신은 preprocessing 단계 (hash 20개 전송, parms/pk/ chosen_hashes 수신)
-    std::uint64_t pre_bytes_s2c = wire.bytes_sent(); // server -> client
-    std::uint64_t pre_bytes_c2s = wire.bytes_recv(); // client -> server
-    std::uint64_t pre_us_send   = wire.send_time_us();
-    std::uint64_t pre_us_recv   = wire.recv_time_us();
-
-
-    // --- 클라이언트 쿼리 ciphertext 수신 ---
-    wire.reset_stats();
-    seal::Ciphertext ct_all;
-    recv_seal_obj(wire, ct_all, context);
-    std::cout << "Received ct_all from client\n";
-    
-    // server encoding
-    std::vector<std::vector<seal::Plaintext>> server_plaintexts_set;
-    size_t num_hash = chosen_hashes.size();                
-    for (size_t h = 0; h < num_hash; ++h) {
-
-        const auto& simple_table_vec = server_tables[h].get_table();
-    
-
-        // STEP 1: pad
-        uint32_t padding = 1<<r;
-        auto padded = pad_simple_table_vec(simple_table_vec, padding);
-
-        // STEP 2: encode
-        auto server_plaintexts = encode_simple_table(
-            padded, batch_encoder, padding
-        );
-
-        server_plaintexts_set.push_back(std::move(server_plaintexts));
+    // labeled mode: "원소 label" 줄 (없는 원소는 label 0)
+    if (args.has("labels")) {
+        opts.labels     = read_label_file(args.get("labels", ""));
+        if (opts.labels.empty()) throw std::invalid_argument("no labels read from " + args.get("labels", ""));
+        opts.label_bits = static_cast<size_t>(args.get_int("label-bits", 32));
+        std::cout << "Loaded " << opts.labels.size() << " labels (" << opts.label_bits << " bits)\n";
     }
-    
-    
-    // ====================== 서버: 난수 plaintext 생성 ======================
-    std::vector<uint64_t> rand_vec(batch_encoder.slot_count());
-    uint32_t t = parms.plain_modulus().value();
-    std::mt19937_64 rng(std::random_device{}());
-    std::uniform_int_distribution<uint32_t> dist(1, t - 1);
-
-    for (size_t i = 0; i < bins; ++i) {
-        rand_vec[i]=(rand()%10)+1; // 1~t-1에서 uniform하게
-    }
-
-    seal::Plaintext rand_plain;
-    batch_encoder.encode(rand_vec, rand_plain);
-
-    long long total_us_comp = 0;
-
-    // ====================== 서버: compare_results 계산 + 전송 ======================
-    for (size_t h = 0; h < num_hash; ++h) {
-        std::vector<seal::Ciphertext> compare_results;
-
-        auto start_comp = std::chrono::high_resolution_clock::now();
-
-        // ct_all + server_plaintexts[h][i], 그리고 rand_plain로 곱하기
-        for (const auto& pt : server_plaintexts_set[h]) {
-            seal::Ciphertext diff;
-            evaluator.sub_plain(ct_all, pt, diff);
-            evaluator.multiply_plain_inplace(diff, rand_plain);
-            compare_results.push_back(std::move(diff));
-        }
-
-        auto end_comp = std::chrono::high_resolution_clock::now();
-        auto us_comp = std::chrono::duration_cast<std::chrono::microseconds>(
-                        end_comp - start_comp
-                    ).count();
 
-        double ms_comp = us_comp / 1000.0;
-        total_us_comp += us_comp;
+    // table cache, context/public key cache, shard worker, pinned table 은 PsiServer 가 들고 있음
+    // (pcpsi/psi_server.h)
+    PsiServer server(PsiParams::packing_1d(), std::move(server_elems), opts);
 
-        // ---- 결과를 클라이언트에 전송 ----
-        // 1) 이 hash에 대한 ciphertext 개수 먼저 전송
-        send_u64(wire, static_cast<std::uint64_t>(compare_results.size()));
-
-        // 2) 각 ciphertext 전송
-        for (const auto& ct : compare_results) {
-            send_seal_obj(wire, ct);
-        }
-
-        std::cout << "[server] hash " << h
-                << " compare_results = " << compare_results.size()
-                << ", comp time = " << ms_comp << " ms\n";
+    if (daemon) {
+        // ------------------ daemon 모드: accept loop + worker pool ------------------
+        server.serve_forever(transport, num_workers);
     }
-    
-    double ms_gen_sim = us_gen_sim / 1000.0;
-
-    std::cout << "\n[server] SIMPLE table time = "
-          << ms_gen_sim
-          << std::endl;
-
-    double total_ms_comp = total_us_comp / 1000.0;
-    std::cout << "[server] TOTAL compare time = "
-          << total_ms_comp << "\n";
-    
-
-    // ==== 통신 통계 출력 ====
-
-    // 1) preprocessing 단계
-    double pre_mb_s2c  = pre_bytes_s2c / (1024.0 * 1024.0);
-    double pre_mb_c2s  = pre_bytes_c2s / (1024.0 * 1024.0);
-    double pre_ms_send = pre_us_send / 1000.0;
-    double pre_ms_recv = pre_us_recv / 1000.0;
-
-    std::cout << "\n[server][preprocessing] bytes server->client: "
-              << pre_bytes_s2c << " B (" << pre_mb_s2c << " MB)\n";
-    std::cout << "[server][preprocessing] bytes client->server: "
-              << pre_bytes_c2s << " B (" << pre_mb_c2s << " MB)\n";
-    std::cout << "[server][preprocessing] time send: " << pre_ms_send << " ms, "
-              << "recv: " << pre_ms_recv << " ms, "
-              << "total comm time: " << (pre_ms_send + pre_ms_recv) << " ms\n";
-
-    // 2) online 단계 (reset 이후)
-    double online_mb_s2c  = wire.bytes_sent() / (1024.0 * 1024.0);
-    double online_mb_c2s  = wire.bytes_recv() / (1024.0 * 1024.0);
-    double online_ms_send = wire.send_time_us() / 1000.0;
-    double online_ms_recv = wire.recv_time_us() / 1000.0;
-
-    std::cout << "\n[server][online] bytes server->client: "
-              << wire.bytes_sent() << " B (" << online_mb_s2c << " MB)\n";
-    std::cout << "[server][online] bytes client->server: "
-              << wire.bytes_recv() << " B (" << online_mb_c2s << " MB)\n";
-    std::cout << "[server][online] time send: " << online_ms_send << " ms, "
-              << "recv: " << online_ms_recv << " ms, "
-              << "total comm time: " << (online_ms_send + online_ms_recv) << " ms\n";
-
+    server.serve_one(transport);
 
     return 0;
 }
@@ -0,0 +1,89 @@
+#pragma once
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// 간단한 command line 파서
+//   --name=value / --flag  -> options
+//   나머지                 -> positional (기존 host/port 인자 순서 그대로)
+class CliArgs {
+public:
+    CliArgs(int argc, char** argv) {
+        for (int i = 1; i < argc; ++i) {
+            std::string a = argv[i];
+            if (a.rfind("--", 0) == 0) {
+                auto eq = a.find('=');
+                if (eq == std::string::npos) options_[a.substr(2)] = "1";
+                else options_[a.substr(2, eq - 2)] = a.substr(eq + 1);
+            } else {
+                positional_.push_back(a);
+            }
+        }
+    }
+
+    size_t num_positional() const { return positional_.size(); }
+
+    std::string positional(size_t i, const std::string& def) const {
+        return i < positional_.size() ? positional_[i] : def;
+    }
+    int positional_int(size_t i, int def) const {
+        return i < positional_.size() ? std::stoi(positional_[i]) : def;
+    }
+
+    bool has(const std::string& name) const { return options_.count(name) != 0; }
+
+    std::string get(const std::string& name, const std::string& def) const {
+        auto it = options_.find(name);
+        return it == options_.end() ? def : it->second;
+    }
+    long long get_int(const std::string& name, long long def) const {
+        auto it = options_.find(name);
+        if (it == options_.end()) return def;
+        try {
+            return std::stoll(it->second);
+        } catch (const std::exception&) {
+            throw std::invalid_argument("invalid value for --" + name + ": " + it->second);
+        }
+    }
+    double get_double(const std::string& name, double def) const {
+        auto it = options_.find(name);
+        if (it == options_.end()) return def;
+        try {
+            return std::stod(it->second);
+        } catch (const std::exception&) {
+            throw std::invalid_argument("invalid value for --" + name + ": " + it->second);
+        }
+    }
+    // --name=a,b,c -> {"a", "b", "c"} (없으면 빈 vector)
+    std::vector<std::string> get_list(const std::string& name) const {
+        std::vector<std::string> out;
+        auto it = options_.find(name);
+        if (it == options_.end()) return out;
+        size_t pos = 0;
+        const std::string& s = it->second;
+        while (pos <= s.size()) {
+            size_t comma = s.find(',', pos);
+            if (comma == std::string::npos) comma = s.size();
+            out.push_back(s.substr(pos, comma - pos));
+            pos = comma + 1;
+        }
+        return out;
+    }
+    // --name=1,2,4 -> {1, 2, 4} (없으면 빈 vector)
+    std::vector<size_t> get_size_list(const std::string& name) const {
+        std::vector<size_t> out;
+        for (const auto& item : get_list(name)) {
+            try {
+                out.push_back(static_cast<size_t>(std::stoull(item)));
+            } catch (const std::exception&) {
+                throw std::invalid_argument("invalid value for --" + name + ": " + get(name, ""));
+            }
+        }
+        return out;
+    }
+
+private:
+    std::vector<std::string> positional_;
+    std::map<std::string, std::string> options_;
+};
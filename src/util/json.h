@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+// 한 줄짜리 JSON object 를 만드는 최소 writer (benchmark / timing record 용)
+//
+//   JsonObject o;
+//   o.add("packing", "2d").add("client_exp", 12).add("ok", true);
+//   os << o.str();          // {"packing":"2d","client_exp":12,"ok":true}
+//
+// nested object 는 add_raw 로 이미 만든 JSON 을 넣음.
+class JsonObject {
+public:
+    JsonObject& add(const std::string& key, const std::string& v) { return add_raw(key, quote(v)); }
+    JsonObject& add(const std::string& key, const char* v) { return add_raw(key, quote(v)); }
+    JsonObject& add(const std::string& key, bool v) { return add_raw(key, v ? "true" : "false"); }
+
+    template <class T, class = std::enable_if_t<std::is_arithmetic<T>::value>>
+    JsonObject& add(const std::string& key, T v) {
+        std::ostringstream os;
+        if constexpr (std::is_floating_point<T>::value) {
+            if (!std::isfinite(v)) return add_raw(key, "null");
+            os << std::setprecision(10) << v;
+        } else {
+            os << v;
+        }
+        return add_raw(key, os.str());
+    }
+
+    JsonObject& add_raw(const std::string& key, const std::string& json) {
+        body_ += body_.empty() ? "" : ",";
+        body_ += quote(key) + ":" + json;
+        return *this;
+    }
+
+    // 다른 object 의 field 를 뒤에 붙임
+    JsonObject& merge(const JsonObject& o) {
+        if (!o.body_.empty()) body_ += (body_.empty() ? "" : ",") + o.body_;
+        return *this;
+    }
+
+    bool empty() const { return body_.empty(); }
+    std::string str() const { return "{" + body_ + "}"; }
+
+    static std::string quote(const std::string& s) {
+        std::string out = "\"";
+        for (char c : s) {
+            switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n";  break;
+            case '\t': out += "\\t";  break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+            }
+        }
+        return out + "\"";
+    }
+
+private:
+    std::string body_;
+};
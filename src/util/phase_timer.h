@@ -0,0 +1,242 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <time.h>
+
+#include "json.h"
+#include "trace.h"
+
+// party (client / server) 하나의 phase 별 시간 + 통신량 기록
+//
+//   PhaseRegistry phases("server");
+//   {
+//       PhaseScope setup(phases, "setup", wire);     // wire 의 bytes_sent()/bytes_recv() 차이도 기록
+//       { PhaseScope ctx(phases, "context"); ... }   // path "setup/context"
+//       us = setup.stop().wall_us;                   // 끝나기 전에 값이 필요하면 stop()
+//   }
+//   sink.write(phases);                              // JSON 한 줄
+//
+// 같은 부모 아래 같은 이름의 phase 는 하나로 합쳐지고 (count 증가), index 를 주면
+// 따로 기록됨 (query[1], query[2], ...). wall time 은 steady_clock, cpu time 은 phase 를
+// 연 thread 의 CPU 시간 (CLOCK_THREAD_CPUTIME_ID) 이므로 다른 thread 의 일 (I/O thread,
+// 병렬 복호) 은 wall 에만 들어감. byte counter 가 없는 phase 는 자식 phase 의 byte 합.
+// registry 는 thread 하나에서만 사용 (session 하나 = registry 하나).
+// set_trace 로 TraceRecorder 를 붙이면 phase 마다 span 도 하나씩 (cat "phase").
+
+struct PhaseTimes {
+    long long     wall_us    = 0;
+    long long     cpu_us     = 0;
+    std::uint64_t bytes_sent = 0;
+    std::uint64_t bytes_recv = 0;
+
+    PhaseTimes& operator+=(const PhaseTimes& o) {
+        wall_us    += o.wall_us;
+        cpu_us     += o.cpu_us;
+        bytes_sent += o.bytes_sent;
+        bytes_recv += o.bytes_recv;
+        return *this;
+    }
+};
+
+inline long long thread_cpu_us() {
+    timespec ts{};
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<long long>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+class PhaseRegistry {
+public:
+    explicit PhaseRegistry(std::string party) : party_(std::move(party)) { clear(); }
+
+    // 새 run (연결) 시작: phase 와 meta 를 비움
+    void clear() {
+        if (!stack_.empty()) throw std::logic_error("PhaseRegistry::clear with open phases");
+        nodes_.clear();
+        by_path_.clear();
+        meta_ = JsonObject{};
+        start_unix_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // record 에 같이 넣을 설정 값 (packing, segment 개수, ...)
+    JsonObject& meta() { return meta_; }
+
+    void set_trace(TraceRecorder* trace) { trace_ = trace; }
+    TraceRecorder* trace() const { return trace_; }
+
+    const PhaseTimes* find(const std::string& path) const {
+        auto it = by_path_.find(path);
+        return it == by_path_.end() ? nullptr : &nodes_[it->second].total;
+    }
+
+    // {"party":...,<meta>,"start_unix_ms":...,"phases":[{"path":"setup/context",...},...]}
+    // phases 는 처음 연 순서 (부모가 자식보다 앞)
+    std::string json() const {
+        std::string phases = "[";
+        for (size_t i = 0; i < nodes_.size(); ++i) {
+            const Node& n = nodes_[i];
+            JsonObject p;
+            p.add("path", n.path).add("name", n.name);
+            if (n.index >= 0) p.add("index", n.index);
+            p.add("depth", n.depth).add("count", n.count)
+             .add("wall_us", n.total.wall_us).add("cpu_us", n.total.cpu_us)
+             .add("bytes_sent", n.total.bytes_sent).add("bytes_recv", n.total.bytes_recv);
+            phases += (i ? "," : "") + p.str();
+        }
+        phases += "]";
+
+        JsonObject record;
+        record.add("party", party_).merge(meta_)
+              .add("start_unix_ms", start_unix_ms_).add_raw("phases", phases);
+        return record.str();
+    }
+
+private:
+    friend class PhaseScope;
+
+    struct Node {
+        std::string name;
+        std::string path;
+        long long   index;
+        size_t      depth;
+        size_t      count = 0;
+        PhaseTimes  total;
+    };
+    struct Open {
+        size_t        node;
+        std::uint64_t child_sent = 0;   // counter 없는 phase 용 자식 byte 합
+        std::uint64_t child_recv = 0;
+    };
+
+    size_t open(const std::string& name, long long index) {
+        std::string path = stack_.empty() ? "" : nodes_[stack_.back().node].path + "/";
+        path += index >= 0 ? name + "[" + std::to_string(index) + "]" : name;
+        auto [it, inserted] = by_path_.emplace(path, nodes_.size());
+        if (inserted) {
+            Node node;
+            node.name  = name;
+            node.path  = std::move(path);
+            node.index = index;
+            node.depth = stack_.size();
+            nodes_.push_back(std::move(node));
+        }
+        stack_.push_back(Open{it->second});
+        return it->second;
+    }
+
+    // has_bytes 가 false 면 t 의 byte 는 자식 합으로 채움
+    PhaseTimes close(size_t node, PhaseTimes t, bool has_bytes) {
+        if (stack_.empty() || stack_.back().node != node)
+            throw std::logic_error("phase '" + nodes_[node].path + "' closed out of order");
+        if (!has_bytes) {
+            t.bytes_sent = stack_.back().child_sent;
+            t.bytes_recv = stack_.back().child_recv;
+        }
+        stack_.pop_back();
+        if (!stack_.empty()) {
+            stack_.back().child_sent += t.bytes_sent;
+            stack_.back().child_recv += t.bytes_recv;
+        }
+        nodes_[node].count += 1;
+        nodes_[node].total += t;
+        return t;
+    }
+
+    std::string party_;
+    TraceRecorder* trace_ = nullptr;
+    long long start_unix_ms_ = 0;
+    JsonObject meta_;
+    std::vector<Node> nodes_;
+    std::unordered_map<std::string, size_t> by_path_;
+    std::vector<Open> stack_;
+};
+
+// scope 가 끝나면 (또는 stop()) registry 에 기록
+class PhaseScope {
+public:
+    PhaseScope(PhaseRegistry& reg, const std::string& name, long long index = -1)
+        : reg_(reg), node_(reg.open(name, index)), index_(index),
+          start_wall_(std::chrono::steady_clock::now()), start_cpu_(thread_cpu_us()) {}
+
+    // Counter: bytes_sent() / bytes_recv() 가 있는 것 (Wire). scope 안에서 reset_stats 하면 안 됨
+    template <class Counter>
+    PhaseScope(PhaseRegistry& reg, const std::string& name, const Counter& counter, long long index = -1)
+        : PhaseScope(reg, name, index)
+    {
+        bytes_ = [&counter] { return std::make_pair(counter.bytes_sent(), counter.bytes_recv()); };
+        start_bytes_ = bytes_();
+    }
+
+    PhaseScope(const PhaseScope&)            = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+
+    ~PhaseScope() {
+        if (stopped_) return;
+        try {
+            stop();
+        } catch (const std::exception&) {
+            // 순서가 어긋난 경우: 기록만 빠짐
+        }
+    }
+
+    // 이 구간의 값 (한 번만)
+    PhaseTimes stop() {
+        if (stopped_) throw std::logic_error("PhaseScope stopped twice");
+        stopped_ = true;
+        PhaseTimes t;
+        auto end_wall = std::chrono::steady_clock::now();
+        t.wall_us = std::chrono::duration_cast<std::chrono::microseconds>(end_wall - start_wall_).count();
+        t.cpu_us = thread_cpu_us() - start_cpu_;
+        if (bytes_) {
+            auto [sent, recv] = bytes_();
+            t.bytes_sent = sent - start_bytes_.first;
+            t.bytes_recv = recv - start_bytes_.second;
+        }
+        t = reg_.close(node_, t, static_cast<bool>(bytes_));
+        if (TraceRecorder* trace = reg_.trace()) {
+            JsonObject args;
+            if (index_ >= 0) args.add("index", index_);
+            if (t.bytes_sent || t.bytes_recv) args.add("bytes_sent", t.bytes_sent).add("bytes_recv", t.bytes_recv);
+            trace->add(reg_.nodes_[node_].name, "phase", start_wall_, end_wall, args.empty() ? "" : args.str());
+        }
+        return t;
+    }
+
+private:
+    PhaseRegistry& reg_;
+    size_t node_;
+    long long index_;
+    std::chrono::steady_clock::time_point start_wall_;
+    long long start_cpu_;
+    std::function<std::pair<std::uint64_t, std::uint64_t>()> bytes_;
+    std::pair<std::uint64_t, std::uint64_t> start_bytes_{0, 0};
+    bool stopped_ = false;
+};
+
+// run 마다 JSON record 한 줄을 파일에 append (daemon 의 여러 session 이 같이 씀)
+class PhaseSink {
+public:
+    explicit PhaseSink(const std::string& path) : out_(path, std::ios::app) {
+        if (!out_) throw std::runtime_error("cannot open phase log: " + path);
+    }
+
+    void write(const PhaseRegistry& phases) {
+        std::string line = phases.json();
+        std::lock_guard<std::mutex> lock(mu_);
+        out_ << line << "\n";
+        out_.flush();
+    }
+
+private:
+    std::mutex    mu_;
+    std::ofstream out_;
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "json.h"
+
+// Chrome trace event format (chrome://tracing, ui.perfetto.dev) span 기록
+//
+//   TraceRecorder trace("server", 1);
+//   { TraceSpan s(&trace, "eval.row", "eval"); ... }       // recorder 가 nullptr 이면 아무것도 안 함
+//   trace.set_origin(t0);                                   // session clock 의 0
+//   trace.write("server_trace.json");
+//
+// 여러 thread 에서 동시에 span 을 추가해도 됨 (thread 마다 tid lane 하나). query 마다 새로 뜨는
+// thread (I/O, stripe 수신, 복호) 는 lane("send I/O 1") 처럼 이름 있는 lane 에 기록해서
+// lane 이 query 마다 늘어나지 않게 함.
+// ts 는 origin 기준 us. client 와 server 는 같은 session clock 을 쓰도록 origin 을 맞추고
+// (protocol/server_session.h 의 clock sync) pid 를 다르게 두므로, 두 파일의 traceEvents 를
+// 이어 붙이면 한 timeline 에 같이 보임.
+class TraceRecorder {
+public:
+    using clock = std::chrono::steady_clock;
+
+    TraceRecorder(std::string process_name, int pid)
+        : process_name_(std::move(process_name)), pid_(pid), origin_(clock::now()) {}
+
+    TraceRecorder(const TraceRecorder&)            = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    void set_origin(clock::time_point t) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        origin_ = t;
+    }
+
+    // args 는 JSON object (비어 있으면 생략). lane 0 이면 부른 thread 의 lane
+    void add(std::string name, const char* cat, clock::time_point start, clock::time_point end,
+             std::string args = {}, int lane = 0)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_.push_back(Event{std::move(name), cat, lane ? lane : tid_locked(), start, end, std::move(args)});
+    }
+
+    // 이름으로 찾는 lane (없으면 만듦)
+    int lane(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto [it, inserted] = lanes_.emplace(name, next_tid_);
+        if (inserted) thread_names_[next_tid_++] = name;
+        return it->second;
+    }
+
+    // 부른 thread 의 lane 이름
+    void name_thread(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        thread_names_[tid_locked()] = name;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return events_.size();
+    }
+
+    void write(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) throw std::runtime_error("cannot open trace file: " + path);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        JsonObject proc;
+        proc.add("name", "process_name").add("ph", "M").add("pid", pid_)
+            .add_raw("args", JsonObject().add("name", process_name_).str());
+        out << proc.str();
+        for (const auto& [tid, name] : thread_names_) {
+            JsonObject t;
+            t.add("name", "thread_name").add("ph", "M").add("pid", pid_).add("tid", tid)
+             .add_raw("args", JsonObject().add("name", name).str());
+            out << ",\n" << t.str();
+        }
+        for (const auto& e : events_) {
+            JsonObject ev;
+            ev.add("name", e.name).add("cat", e.cat).add("ph", "X")
+              .add("ts", us_since_origin(e.start)).add("dur", us_between(e.start, e.end))
+              .add("pid", pid_).add("tid", e.tid);
+            if (!e.args.empty()) ev.add_raw("args", e.args);
+            out << ",\n" << ev.str();
+        }
+        out << "\n]}\n";
+    }
+
+private:
+    struct Event {
+        std::string name;
+        const char* cat;
+        int tid;
+        clock::time_point start;
+        clock::time_point end;
+        std::string args;
+    };
+
+    int tid_locked() {
+        auto [it, inserted] = tids_.emplace(std::this_thread::get_id(), next_tid_);
+        if (inserted) ++next_tid_;
+        return it->second;
+    }
+
+    double us_since_origin(clock::time_point t) const {
+        return std::chrono::duration<double, std::micro>(t - origin_).count();
+    }
+    static double us_between(clock::time_point a, clock::time_point b) {
+        return std::chrono::duration<double, std::micro>(b - a).count();
+    }
+
+    std::string process_name_;
+    int pid_;
+    mutable std::mutex mutex_;
+    clock::time_point origin_;
+    std::vector<Event> events_;
+    int next_tid_ = 1;
+    std::unordered_map<std::thread::id, int> tids_;
+    std::unordered_map<std::string, int> lanes_;
+    std::unordered_map<int, std::string> thread_names_;
+};
+
+// scope 하나 = span 하나. name / cat 은 문자열 literal (포인터만 저장, 기록할 때 복사)
+class TraceSpan {
+public:
+    TraceSpan(TraceRecorder* rec, const char* name, const char* cat, int lane = 0)
+        : rec_(rec), name_(name), cat_(cat), lane_(lane)
+    {
+        if (rec_) start_ = TraceRecorder::clock::now();
+    }
+
+    TraceSpan(const TraceSpan&)            = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    ~TraceSpan() {
+        if (rec_) rec_->add(name_, cat_, start_, TraceRecorder::clock::now(), std::move(args_), lane_);
+    }
+
+    // 기록할 때만 만들도록 recorder 가 있는지 먼저 확인
+    bool enabled() const { return rec_ != nullptr; }
+    void set_args(const JsonObject& args) { if (rec_) args_ = args.str(); }
+
+private:
+    TraceRecorder* rec_;
+    const char* name_;
+    const char* cat_;
+    int lane_;
+    TraceRecorder::clock::time_point start_;
+    std::string args_;
+};
+
+// 같은 설정으로 session 을 여러 번 기록할 때: 1 번째는 path 그대로, n 번째는 a.json -> a.n.json
+inline std::string numbered_trace_path(const std::string& path, size_t n) {
+    if (n <= 1) return path;
+    auto dot   = path.rfind('.');
+    auto slash = path.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return path + "." + std::to_string(n);
+    return path.substr(0, dot) + "." + std::to_string(n) + path.substr(dot);
+}